@@ -0,0 +1,122 @@
+//	Copyright 2017 Adam Smith
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+
+#ifndef ASMITH_SERIAL_ARENA_HPP
+#define ASMITH_SERIAL_ARENA_HPP
+
+namespace asmith { namespace serial {
+
+	//! \brief Monotonic allocator for whole value trees
+	//! \detail While a scope is active on the current thread every string, array and object created by a value is
+	//! allocated from the arena. Values backed by an arena skip their destructors, so a tree is freed in O(1) by
+	//! calling release(). The arena must outlive every value allocated from it, and values added to an arena
+	//! backed tree should be created while the scope is active. Shared payloads copied while a scope is active are
+	//! copied into the arena, as are object member names that are not held by the interned_key table, so none of
+	//! them need the destructors that arena backed trees skip. Moving a heap or shared value into an arena backed tree
+	//! leaks it.
+	class value_arena {
+	private:
+		struct block {
+			block* next;
+			size_t capacity;
+		};
+
+		block* mHead;
+		uint8_t* mPosition;
+		uint8_t* mEnd;
+		size_t mBlockSize;
+		size_t mAllocated;
+
+		value_arena(const value_arena&) = delete;
+		value_arena& operator=(const value_arena&) = delete;
+	public:
+		class scope {
+		private:
+			value_arena* mPrevious;
+
+			scope(const scope&) = delete;
+			scope& operator=(const scope&) = delete;
+		public:
+			scope(value_arena&) throw();
+			scope(value_arena*) throw();
+			~scope() throw();
+		};
+
+		value_arena(size_t = 64 * 1024) throw();
+		~value_arena() throw();
+
+		void* allocate(size_t, size_t);
+		void release() throw();
+		size_t size() const throw();
+
+		static value_arena* get_current() throw();
+	};
+
+	template<class T>
+	class value_allocator {
+	private:
+		value_arena* mArena;
+	public:
+		typedef T value_type;
+		typedef std::false_type propagate_on_container_copy_assignment;
+		typedef std::true_type propagate_on_container_move_assignment;
+		typedef std::true_type propagate_on_container_swap;
+
+		value_allocator() throw() :
+			mArena(value_arena::get_current())
+		{}
+
+		explicit value_allocator(value_arena* aArena) throw() :
+			mArena(aArena)
+		{}
+
+		template<class T2>
+		value_allocator(const value_allocator<T2>& aOther) throw() :
+			mArena(aOther.get_arena())
+		{}
+
+		T* allocate(const size_t aCount) {
+			const size_t bytes = aCount * sizeof(T);
+			return static_cast<T*>(mArena ? mArena->allocate(bytes, alignof(T)) : ::operator new(bytes));
+		}
+
+		void deallocate(T* aPtr, const size_t) throw() {
+			if(! mArena) ::operator delete(aPtr);
+		}
+
+		value_allocator select_on_container_copy_construction() const throw() {
+			return value_allocator();
+		}
+
+		value_arena* get_arena() const throw() {
+			return mArena;
+		}
+	};
+
+	template<class A, class B>
+	bool operator==(const value_allocator<A>& aFirst, const value_allocator<B>& aSecond) throw() {
+		return aFirst.get_arena() == aSecond.get_arena();
+	}
+
+	template<class A, class B>
+	bool operator!=(const value_allocator<A>& aFirst, const value_allocator<B>& aSecond) throw() {
+		return aFirst.get_arena() != aSecond.get_arena();
+	}
+}}
+
+#endif
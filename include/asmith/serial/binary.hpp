@@ -11,16 +11,153 @@
 //	See the License for the specific language governing permissions and
 //	limitations under the License.
 
+#include <string>
+#include <vector>
 #include "format.hpp"
 
 #ifndef ASMITH_SERIAL_BINARY_HPP
 #define ASMITH_SERIAL_BINARY_HPP
 	
 namespace asmith { namespace serial {
+	//! \brief Compact native endian encoding of a value
+	//! \detail Documents begin with a magic number and version, lengths are written as LEB128 numbers. Version 1
+	//! documents, which had no header and 16 bit lengths, can still be read. Packed arrays are written as their
+	//! element type followed by the raw elements. Documents with arrays or objects nested more than 512 deep are
+	//! rejected when they are read.
 	class binary_format : public format {
+	public:
+		enum : uint8_t {
+			VERSION = 3
+		};
+	private:
+		bool mIndexed;
+		bool mKeyDictionary;
+		bool mColumnar;
+	public:
+		binary_format();
+
+		//! \brief Write offset tables for arrays and objects so that a binary_document can access them directly
+		//! \detail Adds 8 bytes per element and member. The tree is walked twice: the first pass measures every
+		//! container so that the tables can hold final offsets, the second streams the document. The measurements
+		//! take 16 bytes per array and object, the output itself is never held in memory.
+		binary_format& set_indexed(const bool);
+
+		//! \brief Write each distinct member name once at the start of the document and refer to it by index
+		binary_format& set_key_dictionary(const bool);
+
+		//! \brief Write arrays of objects that have the same members as one column per member
+		//! \detail Columns of numbers of the same type are packed into the smallest element type that holds them
+		//! exactly. Arrays are read back as arrays of objects.
+		binary_format& set_columnar(const bool);
+
+		// Inherited from format
+
+		using format::read_serial;
+
 		void write_serial(const value&, std::ostream&) override;
 		value read_serial(std::istream&) override;
 	};
+
+	//! \brief Characters of a string inside a binary_document, they are not null terminated
+	struct binary_string {
+		const char* data;
+		size_t size;
+
+		std::string str() const { return std::string(data, size); }
+	};
+
+	class binary_document;
+
+	//! \brief Handle to a value inside a binary_document, it is only valid while the document exists
+	class binary_node {
+	private:
+		const binary_document* mDocument;
+		uint64_t mOffset;
+
+		binary_node(const binary_document*, const uint64_t) throw();
+
+		uint64_t element(const size_t) const;
+		value scalar() const;
+		bool is_columnar() const;
+		//! \brief The offsets of the elements or members in ascending order
+		//! \throw std::runtime_error If two of them are the same
+		std::vector<uint64_t> sorted_elements() const;
+		//! \brief Build a value, aEnd is set to the offset after the last byte that was decoded
+		//! \throw std::runtime_error If any children overlap, each node of a document is only decoded once
+		value build(const size_t, uint64_t&) const;
+		value build(const std::vector<std::string>&, const size_t) const;
+
+		friend class binary_document;
+	public:
+		value::type get_type() const;
+
+		//! \brief The number of elements or members, O(1)
+		size_t size() const;
+
+		//! \brief An element of an array or the value of a member, members are ordered by name. O(1)
+		//! \throw std::runtime_error If the node is a columnar array, its rows are read with columns()
+		binary_node operator[](const size_t) const;
+		//! \brief Find a member by binary search
+		//! \throw std::runtime_error If there is no member with the name
+		binary_node operator[](const std::string&) const;
+		bool find(const char*, const size_t, binary_node&) const;
+
+		//! \brief The name of a member, members are ordered by name
+		binary_string key(const size_t) const;
+
+		//! \brief An object with a member for each column of a columnar array, the columns are arrays or packed
+		//! arrays with an element per row
+		//! \throw std::runtime_error If the node was not written as columns
+		binary_node columns() const;
+
+		value::bool_t get_bool() const;
+		value::char_t get_char() const;
+		value::number_t get_number() const;
+		value::int_t get_int() const;
+		value::uint_t get_uint() const;
+		binary_string get_string() const;
+		//! \brief Elements of a packed array, they are native endian and may not be aligned
+		const char* get_packed_array(value::packed_array_t::element_type&, size_t&) const;
+
+		//! \brief Build a value from this node and everything below it
+		value materialise() const;
+		//! \brief Build an array of objects that only have the named members, the other columns of a columnar
+		//! array are not read
+		value materialise(const std::vector<std::string>&) const;
+	};
+
+	//! \brief Read only view of a document written with binary_format::set_indexed(true)
+	//! \detail Opening a document only checks the header, nodes are decoded when they are accessed. A document over a
+	//! buffer does not copy it, so the buffer must outlive the document.
+	class binary_document {
+	private:
+		const char* mData;
+		size_t mSize;
+		void* mMapping;
+		size_t mMappingSize;
+		uint64_t mKeyCount;
+		uint64_t mKeyTable; //!< Offsets of the names in the key dictionary
+		uint64_t mRoot;
+		bool mKeyDictionary;
+
+		void check();
+		const char* at(const uint64_t, const size_t) const;
+		binary_string string(uint64_t&) const;
+		//! \brief Read the name of a member, advancing the offset to its value
+		binary_string key(uint64_t&) const;
+
+		friend class binary_node;
+	public:
+		binary_document(const char*, const size_t);
+		//! \brief Memory map a file, pages are loaded by the operating system when they are accessed
+		explicit binary_document(const std::string&);
+		~binary_document() throw();
+
+		binary_document(const binary_document&) = delete;
+		binary_document& operator=(const binary_document&) = delete;
+
+		binary_node root() const;
+	};
 }}
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,224 @@
+//	Copyright 2017 Adam Smith
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#ifndef ASMITH_SERIAL_FLAT_MAP_HPP
+#define ASMITH_SERIAL_FLAT_MAP_HPP
+
+// ASMITH_SERIAL_FLAT_OBJECT changes the layout of value, so value is declared in an inline namespace named after the
+// object representation. Code built with a different setting than the library then fails to link. GCC and Clang
+// also tag functions that only return a value, which the namespace alone would not change.
+#ifdef ASMITH_SERIAL_FLAT_OBJECT
+	#define ASMITH_SERIAL_OBJECT_ABI flat_object
+	#define ASMITH_SERIAL_OBJECT_ABI_NAME "flat_object"
+#else
+	#define ASMITH_SERIAL_OBJECT_ABI ordered_object
+	#define ASMITH_SERIAL_OBJECT_ABI_NAME "ordered_object"
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+	#define ASMITH_SERIAL_BEGIN_OBJECT_ABI inline namespace ASMITH_SERIAL_OBJECT_ABI __attribute__((abi_tag(ASMITH_SERIAL_OBJECT_ABI_NAME))) {
+#else
+	#define ASMITH_SERIAL_BEGIN_OBJECT_ABI inline namespace ASMITH_SERIAL_OBJECT_ABI {
+#endif
+#define ASMITH_SERIAL_END_OBJECT_ABI }
+
+namespace asmith { namespace serial {
+
+	//! \brief FNV-1a hash of any contiguous string type
+	struct string_hash {
+		size_t operator()(const char* const aData, const size_t aSize) const throw() {
+			uint64_t hash = 14695981039346656037ull;
+			for(size_t i = 0; i < aSize; ++i) {
+				hash ^= static_cast<uint8_t>(aData[i]);
+				hash *= 1099511628211ull;
+			}
+			return static_cast<size_t>(hash);
+		}
+
+		template<class S>
+		size_t operator()(const S& aString) const throw() {
+			return operator()(aString.data(), aString.size());
+		}
+	};
+
+	//! \brief Associative container that stores its members contiguously in insertion order
+	//! \detail Provides the subset of the std::map interface used by value::object_t users, plus O(1) positional
+	//! access through nth(). Small maps are searched linearly, larger maps maintain an open addressing hash index.
+	//! Like std::vector, inserting or erasing members invalidates references to other members.
+	template<class K, class T, class HASH, class ALLOC>
+	class flat_map {
+	public:
+		typedef K key_type;
+		typedef T mapped_type;
+		typedef std::pair<K, T> value_type;
+		typedef ALLOC allocator_type;
+		typedef typename std::vector<value_type, ALLOC>::iterator iterator;
+		typedef typename std::vector<value_type, ALLOC>::const_iterator const_iterator;
+	private:
+		typedef typename std::allocator_traits<ALLOC>::template rebind_alloc<uint32_t> index_allocator;
+
+		enum : size_t {
+			LINEAR_SEARCH_LIMIT = 8
+		};
+
+		std::vector<value_type, ALLOC> mEntries;
+		std::vector<uint32_t, index_allocator> mIndex; //!< Entry index + 1, 0 marks an empty slot
+
+		size_t find_index(const K& aKey) const throw() {
+			const size_t s = mEntries.size();
+			if(mIndex.empty()) {
+				for(size_t i = 0; i < s; ++i) if(mEntries[i].first == aKey) return i;
+				return s;
+			}
+
+			const size_t mask = mIndex.size() - 1;
+			size_t slot = HASH()(aKey) & mask;
+			while(mIndex[slot] != 0) {
+				const size_t i = mIndex[slot] - 1;
+				if(mEntries[i].first == aKey) return i;
+				slot = (slot + 1) & mask;
+			}
+			return s;
+		}
+
+		void index_entry(const size_t aEntry) throw() {
+			const size_t mask = mIndex.size() - 1;
+			size_t slot = HASH()(mEntries[aEntry].first) & mask;
+			while(mIndex[slot] != 0) slot = (slot + 1) & mask;
+			mIndex[slot] = static_cast<uint32_t>(aEntry + 1);
+		}
+
+		void rebuild_index() {
+			const size_t s = mEntries.size();
+			if(s <= LINEAR_SEARCH_LIMIT) {
+				mIndex.clear();
+				return;
+			}
+
+			// Keep the load factor at or below 0.5
+			size_t slots = 16;
+			while(slots < s * 2) slots *= 2;
+			mIndex.assign(slots, 0);
+			for(size_t i = 0; i < s; ++i) index_entry(i);
+		}
+
+		void on_insert() {
+			const size_t s = mEntries.size();
+			if(s <= LINEAR_SEARCH_LIMIT) return;
+			if(mIndex.size() < s * 2) rebuild_index();
+			else index_entry(s - 1);
+		}
+	public:
+		iterator begin() throw() { return mEntries.begin(); }
+		iterator end() throw() { return mEntries.end(); }
+		const_iterator begin() const throw() { return mEntries.begin(); }
+		const_iterator end() const throw() { return mEntries.end(); }
+		const_iterator cbegin() const throw() { return mEntries.begin(); }
+		const_iterator cend() const throw() { return mEntries.end(); }
+
+		size_t size() const throw() { return mEntries.size(); }
+		bool empty() const throw() { return mEntries.empty(); }
+		allocator_type get_allocator() const throw() { return mEntries.get_allocator(); }
+
+		void clear() throw() {
+			mEntries.clear();
+			mIndex.clear();
+		}
+
+		void reserve(const size_t aSize) {
+			mEntries.reserve(aSize);
+		}
+
+		iterator nth(const size_t aIndex) throw() { return mEntries.begin() + aIndex; }
+		const_iterator nth(const size_t aIndex) const throw() { return mEntries.begin() + aIndex; }
+
+		iterator find(const K& aKey) throw() { return mEntries.begin() + find_index(aKey); }
+		const_iterator find(const K& aKey) const throw() { return mEntries.begin() + find_index(aKey); }
+		size_t count(const K& aKey) const throw() { return find_index(aKey) < mEntries.size() ? 1 : 0; }
+
+		template<class K2, class... ARGS>
+		std::pair<iterator, bool> emplace(K2&& aKey, ARGS&&... aArgs) {
+			K key(std::forward<K2>(aKey));
+			const size_t i = find_index(key);
+			if(i < mEntries.size()) return std::pair<iterator, bool>(mEntries.begin() + i, false);
+			mEntries.emplace_back(
+				std::piecewise_construct,
+				std::forward_as_tuple(std::move(key)),
+				std::forward_as_tuple(std::forward<ARGS>(aArgs)...)
+			);
+			on_insert();
+			return std::pair<iterator, bool>(mEntries.end() - 1, true);
+		}
+
+		std::pair<iterator, bool> insert(const value_type& aValue) {
+			return emplace(aValue.first, aValue.second);
+		}
+
+		std::pair<iterator, bool> insert(value_type&& aValue) {
+			return emplace(std::move(aValue.first), std::move(aValue.second));
+		}
+
+		T& operator[](const K& aKey) {
+			return emplace(aKey).first->second;
+		}
+
+		T& at(const K& aKey) {
+			const size_t i = find_index(aKey);
+			if(i == mEntries.size()) throw std::out_of_range("flat_map : Key not found");
+			return mEntries[i].second;
+		}
+
+		const T& at(const K& aKey) const {
+			const size_t i = find_index(aKey);
+			if(i == mEntries.size()) throw std::out_of_range("flat_map : Key not found");
+			return mEntries[i].second;
+		}
+
+		iterator erase(const_iterator aPosition) {
+			const size_t i = aPosition - mEntries.cbegin();
+			mEntries.erase(mEntries.begin() + i);
+			rebuild_index();
+			return mEntries.begin() + i;
+		}
+
+		size_t erase(const K& aKey) {
+			const size_t i = find_index(aKey);
+			if(i == mEntries.size()) return 0;
+			erase(mEntries.cbegin() + i);
+			return 1;
+		}
+
+		bool operator==(const flat_map& aOther) const {
+			if(mEntries.size() != aOther.mEntries.size()) return false;
+			for(const value_type& i : mEntries) {
+				const const_iterator j = aOther.find(i.first);
+				if(j == aOther.end() || ! (j->second == i.second)) return false;
+			}
+			return true;
+		}
+
+		bool operator!=(const flat_map& aOther) const {
+			return ! operator==(aOther);
+		}
+	};
+}}
+
+#endif
@@ -23,6 +23,11 @@ namespace asmith { namespace serial {
 
 		virtual void write_serial(const value&, std::ostream&) = 0;
 		virtual value read_serial(std::istream&) = 0;
+
+		value read_serial(std::istream& aStream, value_arena& aArena) {
+			const value_arena::scope scope(aArena);
+			return read_serial(aStream);
+		}
 	
 		template<class T>
 		void write(const T& aValue, std::ostream& aStream) {
@@ -33,6 +38,11 @@ namespace asmith { namespace serial {
 		T read(std::istream& aStream) {
 			return deserialise<T>(read_serial(aStream));
 		}
+	
+		template<class T>
+		T read(std::istream& aStream, value_arena& aArena) {
+			return deserialise<T>(read_serial(aStream, aArena));
+		}
 	};
 }}
 
@@ -34,6 +34,8 @@ namespace asmith {
 
 			// Inherited from format
 
+			using format::read_serial;
+
 			void write_serial(const value&, std::ostream&) override;
 			value read_serial(std::istream&) override;
 		};
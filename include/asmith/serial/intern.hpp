@@ -0,0 +1,43 @@
+//	Copyright 2017 Adam Smith
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+
+#include <mutex>
+#include <unordered_map>
+#include "value.hpp"
+
+#ifndef ASMITH_SERIAL_INTERN_HPP
+#define ASMITH_SERIAL_INTERN_HPP
+
+namespace asmith { namespace serial {
+
+	//! \brief Hash-consing table for value trees
+	//! \detail intern() returns a shared copy of its argument in which every string, array and object that is
+	//! structurally equal to one seen before shares the same copy-on-write storage. Values stay alive until the
+	//! table is cleared or destroyed. Arena backed values are returned unchanged.
+	class value_intern_table {
+	private:
+		std::unordered_multimap<size_t, value> mValues;
+		mutable std::mutex mLock;
+
+		value_intern_table(const value_intern_table&) = delete;
+		value_intern_table& operator=(const value_intern_table&) = delete;
+	public:
+		value_intern_table() = default;
+
+		value intern(value);
+		size_t size() const;
+		void clear();
+	};
+}}
+
+#endif
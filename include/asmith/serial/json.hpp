@@ -11,26 +11,284 @@
 //	See the License for the specific language governing permissions and
 //	limitations under the License.
 
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
 #include "format.hpp"
+#include "json_index.hpp"
 
 #ifndef ASMITH_SERIAL_JSON_HPP
 #define ASMITH_SERIAL_JSON_HPP
 	
 namespace asmith { namespace serial {
+	class json_document;
+
 	class json_format : public format {
 	private:
 		bool mFancy;
-
-		void write_serial_internal(size_t, const value&, std::ostream&);
 	public:
 		json_format();
 		json_format& set_fancy_writing(const bool);
 
+		//! \brief Parse a document held in a contiguous buffer
+		value read_serial(const char*, const size_t);
+
+		//! \brief Deserialise from the tokens of the document without building a value for all of it
+		//! \detail See deserialise_json, types that do not provide it are read through a value. Like read_serial, one
+		//! document is read from a stream and a buffer must hold exactly one document.
+		template<class T>
+		T read(std::istream&);
+
+		template<class T>
+		T read(const char*, const size_t);
+
 		// Inherited from format
 
+		using format::read_serial;
+		using format::read;
+
 		void write_serial(const value&, std::ostream&) override;
 		value read_serial(std::istream&) override;
 	};
+
+	//! \brief Receives the tokens of a JSON document in order without building a value
+	class json_parser {
+	public:
+		virtual ~json_parser() {}
+
+		virtual void start_object() = 0;
+		virtual void end_object() = 0;
+
+		virtual void start_array() = 0;
+		virtual void end_array() = 0;
+
+		//! \brief Names and strings are passed as decoded UTF-8 that is only valid for the duration of the call
+		virtual void key(const char*, const size_t) = 0;
+
+		virtual void null() = 0;
+		virtual void boolean(const bool) = 0;
+		virtual void number(const double) = 0;
+		virtual void integer(const value::int_t) = 0;
+		virtual void unsigned_integer(const value::uint_t) = 0;
+		virtual void string(const char*, const size_t) = 0;
+	};
+
+	//! \brief Parse the next document of a stream, the stream is left at the first byte after it
+	void read_json(json_parser&, std::istream&);
+	//! \brief Parse a buffer that holds a single document, anything but whitespace after it is an error
+	void read_json(json_parser&, const char*, const size_t);
+
+	class json_writer;
+	class ndjson_chunker;
+
+	//! \brief Reads newline delimited JSON, one document per line
+	//! \detail Input is parsed a chunk of complete lines at a time, empty lines are skipped.
+	class ndjson_reader {
+	private:
+		std::unique_ptr<ndjson_chunker> mChunker;
+		std::string mStorage;
+		std::vector<value> mValues;
+		size_t mNext;
+	public:
+		explicit ndjson_reader(std::istream&);
+		ndjson_reader(const char*, const size_t);
+		~ndjson_reader() throw();
+
+		//! \return False when there are no more documents
+		bool read(value&);
+	};
+
+	//! \brief Parses chunks of newline delimited JSON on several threads
+	//! \detail The callback is always invoked on the calling thread. In ordered mode documents are delivered in the
+	//! order they appear, otherwise each chunk is delivered as soon as it has been parsed.
+	class ndjson_parallel_reader {
+	public:
+		typedef std::function<void(value&&)> callback;
+	private:
+		size_t mThreads;
+		bool mOrdered;
+
+		void read(ndjson_chunker&, const callback&);
+	public:
+		ndjson_parallel_reader();
+		ndjson_parallel_reader& set_threads(const size_t);
+		ndjson_parallel_reader& set_ordered(const bool);
+
+		void read(std::istream&, const callback&);
+		void read(const char*, const size_t, const callback&);
+	};
+
+	//! \brief Writes newline delimited JSON, output is buffered and passed to the stream in large chunks
+	class ndjson_writer {
+	private:
+		std::unique_ptr<json_writer> mWriter;
+	public:
+		explicit ndjson_writer(std::ostream&);
+		~ndjson_writer() throw();
+
+		void write(const value&);
+		void flush();
+	};
+
+	//! \brief Handle to a value inside a json_document
+	//! \detail Nothing is decoded until it is read and containers are walked each time they are accessed, so nodes
+	//! that are used repeatedly should be kept. A node is only valid while its document exists.
+	class json_node {
+	private:
+		const json_document* mDocument;
+		uint32_t mToken;
+
+		json_node(const json_document*, const uint32_t) throw();
+
+		uint32_t close() const;
+		uint32_t skip() const;
+		value get_scalar() const;
+
+		friend class json_document;
+	public:
+		//! \brief Visits the elements of an array or the members of an object in document order
+		class iterator {
+		private:
+			const json_document* mDocument;
+			uint32_t mToken; //!< The current element, or the name of the current member
+			uint32_t mEnd; //!< The closing bracket
+			bool mObject;
+
+			iterator(const json_document*, const uint32_t, const uint32_t, const bool);
+			void check() const;
+
+			friend class json_node;
+		public:
+			json_node operator*() const;
+			iterator& operator++();
+			bool operator==(const iterator&) const throw();
+			bool operator!=(const iterator&) const throw();
+
+			//! \brief The name of the current member when iterating an object
+			value::string_t key() const;
+			void key(std::string&) const;
+		};
+
+		value::type get_type() const;
+		size_t size() const;
+
+		json_node operator[](const size_t) const;
+		json_node operator[](const std::string&) const;
+
+		iterator begin() const;
+		iterator end() const;
+
+		value::bool_t get_bool() const;
+		value::number_t get_number() const;
+		value::int_t get_int() const;
+		value::uint_t get_uint() const;
+		value::string_t get_string() const;
+		void get_string(std::string&) const;
+
+		//! \brief Build a value from this node and everything below it
+		value materialise() const;
+	};
+
+	//! \brief Read only view of a JSON document that decodes values when they are accessed
+	//! \detail Construction only builds the structural index and pairs up brackets. A document over a buffer does not
+	//! copy it, so the buffer must outlive the document and every node taken from it. Only whitespace may follow the
+	//! root value of a buffer.
+	class json_document {
+	private:
+		std::string mStorage;
+		const char* mData;
+		size_t mSize;
+		json_structural_index mIndex;
+		std::vector<uint32_t> mClose; //!< For a token that opens an array or object, the token that closes it
+
+		void build();
+
+		friend class json_node;
+		friend class json_node::iterator;
+	public:
+		json_document(const char*, const size_t);
+		//! \brief Read the next document of the stream into a buffer owned by the document
+		//! \detail The stream is left positioned after the document, as it is by json_format::read_serial.
+		explicit json_document(std::istream&);
+
+		json_document(const json_document&) = delete;
+		json_document& operator=(const json_document&) = delete;
+
+		json_node root() const;
+	};
+
+	//! \brief Incremental JSON parser for a document that arrives in pieces of any size
+	//! \detail All state is kept between calls, so the parser can be suspended whenever a piece has been consumed.
+	//! Tokens split between pieces are buffered until they are complete.
+	class json_push_parser {
+	public:
+		enum status {
+			NEED_MORE_INPUT,
+			COMPLETE
+		};
+	private:
+		enum state : uint8_t {
+			START,
+			ARRAY_START, //!< After '[' or ',' in an array
+			OBJECT_START, //!< After '{' or ',' in an object
+			VALUE, //!< After ':'
+			COLON,
+			AFTER_VALUE,
+			STRING,
+			SCALAR,
+			DONE
+		};
+
+		json_parser* mHandler;
+		std::unique_ptr<json_parser> mBuilder;
+		std::vector<char> mStack; //!< The opening bracket of each open container
+		std::string mToken; //!< The part of a string, number or literal that has been read so far
+		std::string mScratch;
+		size_t mConsumed;
+		state mState;
+		bool mEscape;
+		bool mKey;
+
+		void begin_value(const char);
+		void end_value() throw();
+		void end_string();
+		void end_scalar();
+	public:
+		//! \brief Build the document as a value
+		json_push_parser();
+		//! \brief Pass the tokens of the document to a handler
+		explicit json_push_parser(json_parser&);
+		~json_push_parser() throw();
+
+		//! \return COMPLETE once the document has ended, consumed() is then the number of bytes of this piece that
+		//! belonged to it
+		status feed(const char*, const size_t);
+
+		//! \brief Signal the end of the input, which is needed to complete a document that is only a number
+		//! \throw std::runtime_error If the document is incomplete
+		status finish();
+
+		size_t consumed() const throw();
+
+		//! \brief Take the completed document, when no handler was given
+		value take();
+
+		//! \brief Discard any partial document and prepare to read another
+		void reset();
+	};
+
+	template<class T>
+	T json_format::read(std::istream& aStream) {
+		const json_document document(aStream);
+		return deserialise_json<T>(document.root());
+	}
+
+	template<class T>
+	T json_format::read(const char* aData, const size_t aSize) {
+		const json_document document(aData, aSize);
+		return deserialise_json<T>(document.root());
+	}
 }}
 
 #endif
\ No newline at end of file
@@ -0,0 +1,43 @@
+//	Copyright 2017 Adam Smith
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#ifndef ASMITH_SERIAL_JSON_INDEX_HPP
+#define ASMITH_SERIAL_JSON_INDEX_HPP
+
+namespace asmith { namespace serial {
+
+	//! \brief First stage of the JSON reader
+	//! \detail Records the offset of every brace, bracket, colon and comma outside of a string, every opening quote
+	//! and the first character of every number or literal. The input is classified 64 bytes at a time using AVX2 or
+	//! SSE2 when the processor supports them, otherwise with a scalar loop.
+	class json_structural_index {
+	private:
+		std::vector<uint32_t> mPositions;
+	public:
+		void build(const char*, const size_t);
+
+		const uint32_t* begin() const throw() { return mPositions.data(); }
+		const uint32_t* end() const throw() { return mPositions.data() + mPositions.size(); }
+		size_t size() const throw() { return mPositions.size(); }
+		uint32_t operator[](const size_t aIndex) const throw() { return mPositions[aIndex]; }
+
+		//! \return "avx2", "sse2" or "scalar"
+		static const char* implementation() throw();
+	};
+}}
+
+#endif
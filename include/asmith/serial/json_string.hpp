@@ -0,0 +1,38 @@
+//	Copyright 2017 Adam Smith
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+
+#include <cstddef>
+#include <string>
+
+#ifndef ASMITH_SERIAL_JSON_STRING_HPP
+#define ASMITH_SERIAL_JSON_STRING_HPP
+
+namespace asmith { namespace serial {
+
+	//! \brief Length of the longest prefix that can be copied into a JSON string literal unchanged
+	//! \detail Stops at '"', '\\', control characters and the first byte of a multi-byte UTF-8 sequence. Scans 16 bytes
+	//! at a time with SSE2, or 8 bytes at a time without it.
+	size_t json_plain_length(const char*, const size_t) throw();
+
+	//! \return The length of the UTF-8 sequence at the start of the text, or 0 if it is not valid UTF-8
+	size_t utf8_sequence_length(const char*, const size_t) throw();
+
+	//! \brief Decode the characters between the quotes of a JSON string literal
+	//! \detail \\uXXXX escapes are converted to UTF-8, including surrogate pairs.
+	//! \return False if the text has no escape sequences and can be used as it is, otherwise the decoded text has been
+	//! written to the buffer
+	//! \throw std::runtime_error If the text contains an invalid escape, an unescaped control character or invalid UTF-8
+	bool json_unescape(const char*, const size_t, std::string&);
+}}
+
+#endif
@@ -0,0 +1,157 @@
+//	Copyright 2017 Adam Smith
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <utility>
+
+#ifndef ASMITH_SERIAL_KEY_HPP
+#define ASMITH_SERIAL_KEY_HPP
+
+namespace asmith { namespace serial {
+
+	//! \brief Handle to an object member name stored once in a process wide table
+	//! \detail Equal names in the table always share the same storage, so equality and hashing are O(1). Names in
+	//! the table are never freed, so it stops growing once it holds 64K names. Names that are first seen after
+	//! that are stored in reference counted entries owned by their keys, which compare by content. While a
+	//! value_arena scope is active those entries are allocated from the arena instead, because keys in arena backed
+	//! trees are never destroyed and could not release a reference.
+	class interned_key {
+	public:
+		struct entry {
+			size_t hash;
+			size_t size;
+
+			const char* data() const throw() {
+				return reinterpret_cast<const char*>(this + 1);
+			}
+		};
+	private:
+		enum : uintptr_t {
+			OWNED_FLAG = 1, //!< Set in mEntry when the entry is not in the table
+			ARENA_FLAG = 2 //!< Set with OWNED_FLAG when the entry belongs to a value_arena and is not reference counted
+		};
+
+		uintptr_t mEntry;
+
+		explicit interned_key(const uintptr_t aEntry) throw() :
+			mEntry(aEntry)
+		{}
+
+		const entry* get() const throw() {
+			return reinterpret_cast<const entry*>(mEntry & ~static_cast<uintptr_t>(OWNED_FLAG | ARENA_FLAG));
+		}
+
+		bool counted() const throw() {
+			return (mEntry & (OWNED_FLAG | ARENA_FLAG)) == OWNED_FLAG;
+		}
+
+		static uintptr_t intern(const char*, const size_t);
+		static uintptr_t create_owned(const char*, const size_t, const size_t);
+		static uintptr_t copy(const uintptr_t);
+		static void release(const uintptr_t) throw();
+	public:
+		interned_key() throw();
+
+		interned_key(const char* aString) :
+			mEntry(intern(aString, std::strlen(aString)))
+		{}
+
+		interned_key(const char* aString, const size_t aSize) :
+			mEntry(intern(aString, aSize))
+		{}
+
+		template<class ALLOC>
+		interned_key(const std::basic_string<char, std::char_traits<char>, ALLOC>& aString) :
+			mEntry(intern(aString.data(), aString.size()))
+		{}
+
+		interned_key(const interned_key& aOther) :
+			mEntry(aOther.mEntry & OWNED_FLAG ? copy(aOther.mEntry) : aOther.mEntry)
+		{}
+
+		interned_key(interned_key&& aOther) throw() :
+			interned_key()
+		{
+			std::swap(mEntry, aOther.mEntry);
+		}
+
+		~interned_key() throw() {
+			if(counted()) release(mEntry);
+		}
+
+		interned_key& operator=(const interned_key& aOther) {
+			const uintptr_t tmp = aOther.mEntry & OWNED_FLAG ? copy(aOther.mEntry) : aOther.mEntry;
+			if(counted()) release(mEntry);
+			mEntry = tmp;
+			return *this;
+		}
+
+		interned_key& operator=(interned_key&& aOther) throw() {
+			interned_key tmp(std::move(aOther));
+			std::swap(mEntry, tmp.mEntry);
+			return *this;
+		}
+
+		//! \brief Find a name without adding it to the table
+		//! \return False if no object can contain the name because it has never been interned
+		static bool lookup(const char*, const size_t, interned_key&);
+
+		const char* c_str() const throw() { return get()->data(); }
+		const char* data() const throw() { return get()->data(); }
+		size_t size() const throw() { return get()->size; }
+		bool empty() const throw() { return get()->size == 0; }
+		size_t hash() const throw() { return get()->hash; }
+
+		std::string str() const {
+			return std::string(get()->data(), get()->size);
+		}
+
+		bool operator==(const interned_key& aOther) const throw() {
+			if(mEntry == aOther.mEntry) return true;
+			// A name is either in the table or owned by every key that refers to it
+			if((mEntry & aOther.mEntry & OWNED_FLAG) == 0) return false;
+			const entry* const a = get();
+			const entry* const b = aOther.get();
+			return a->hash == b->hash && a->size == b->size && std::memcmp(a->data(), b->data(), a->size) == 0;
+		}
+
+		bool operator!=(const interned_key& aOther) const throw() {
+			return ! operator==(aOther);
+		}
+
+		bool operator<(const interned_key& aOther) const throw() {
+			// Lexicographic so that ordered objects keep the same member order as std::string keys
+			if(mEntry == aOther.mEntry) return false;
+			const entry* const a = get();
+			const entry* const b = aOther.get();
+			const int cmp = std::memcmp(a->data(), b->data(), a->size < b->size ? a->size : b->size);
+			return cmp == 0 ? a->size < b->size : cmp < 0;
+		}
+	};
+
+	struct interned_key_hash {
+		size_t operator()(const interned_key& aKey) const throw() {
+			return aKey.hash();
+		}
+	};
+
+	inline std::ostream& operator<<(std::ostream& aStream, const interned_key& aKey) {
+		return aStream.write(aKey.data(), aKey.size());
+	}
+}}
+
+#endif
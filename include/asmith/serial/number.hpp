@@ -0,0 +1,59 @@
+//	Copyright 2017 Adam Smith
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+
+#include <ostream>
+#include "value.hpp"
+
+#ifndef ASMITH_SERIAL_NUMBER_HPP
+#define ASMITH_SERIAL_NUMBER_HPP
+
+namespace asmith { namespace serial {
+
+	//! \brief A number read from text, held as the narrowest value type that represents it exactly
+	struct parsed_number {
+		value::type type; //!< INT_T, UINT_T or NUMBER_T
+		union {
+			value::int_t int_value;
+			value::uint_t uint_value;
+			value::number_t number_value;
+		};
+	};
+
+	//! \brief Locale independent parser for the JSON number grammar, a leading '+' is also accepted
+	//! \detail Integers without a fraction or exponent that fit in 64 bits are returned exactly. Everything else is
+	//! rounded to the nearest double, using Clinger's fast path or the Eisel-Lemire algorithm.
+	//! \return The end of the number, or nullptr if the text does not begin with a valid number
+	const char* parse_number(const char*, const char*, parsed_number&) throw();
+
+	enum : size_t {
+		NUMBER_BUFFER_SIZE = 32 //!< The most characters written by format_number
+	};
+
+	//! \brief Locale independent formatter that writes the shortest text which parses back to the same double
+	//! \detail Digits are generated with the Ryu algorithm. Whole numbers below 1e21 are written without a decimal
+	//! point, very large and very small magnitudes use an exponent. NaN and infinity are written as std::ostream
+	//! writes them.
+	//! \return The number of characters written, the text is not null terminated
+	size_t format_number(const value::number_t, char*) throw();
+	size_t format_number(const value::int_t, char*) throw();
+	size_t format_number(const value::uint_t, char*) throw();
+
+	//! \brief Write a number to a stream using format_number
+	template<class T>
+	inline std::ostream& write_number(std::ostream& aStream, const T aValue) {
+		char buf[NUMBER_BUFFER_SIZE];
+		return aStream.write(buf, static_cast<std::streamsize>(format_number(aValue, buf)));
+	}
+}}
+
+#endif
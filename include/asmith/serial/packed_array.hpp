@@ -0,0 +1,235 @@
+//	Copyright 2017 Adam Smith
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "arena.hpp"
+
+#ifndef ASMITH_SERIAL_PACKED_ARRAY_HPP
+#define ASMITH_SERIAL_PACKED_ARRAY_HPP
+
+namespace asmith { namespace serial {
+
+	template<class T>
+	struct packed_element;
+
+	//! \brief Contiguous numbers of a single arithmetic type
+	//! \detail Storage is allocated in 8 byte words so that the data is aligned for every element type.
+	class packed_array {
+	public:
+		enum element_type : uint8_t {
+			INT8_T,
+			INT16_T,
+			INT32_T,
+			INT64_T,
+			UINT8_T,
+			UINT16_T,
+			UINT32_T,
+			UINT64_T,
+			FLOAT_T,
+			DOUBLE_T
+		};
+	private:
+		std::vector<uint64_t, value_allocator<uint64_t>> mWords;
+		size_t mSize;
+		element_type mType;
+
+		static size_t words(const element_type aType, const size_t aSize) throw() {
+			return (aSize * element_size(aType) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+		}
+
+		template<class T>
+		T load(const size_t aIndex) const throw() {
+			T tmp;
+			std::memcpy(&tmp, static_cast<const char*>(data()) + aIndex * sizeof(T), sizeof(T));
+			return tmp;
+		}
+	public:
+		packed_array() throw() :
+			mSize(0),
+			mType(DOUBLE_T)
+		{}
+
+		explicit packed_array(const element_type aType) throw() :
+			mSize(0),
+			mType(aType)
+		{}
+
+		static size_t element_size(const element_type aType) throw() {
+			switch(aType) {
+			case INT8_T:
+			case UINT8_T:
+				return 1;
+			case INT16_T:
+			case UINT16_T:
+				return 2;
+			case INT32_T:
+			case UINT32_T:
+			case FLOAT_T:
+				return 4;
+			default:
+				return 8;
+			}
+		}
+
+		static bool is_floating_point(const element_type aType) throw() {
+			return aType == FLOAT_T || aType == DOUBLE_T;
+		}
+
+		static bool is_signed(const element_type aType) throw() {
+			return aType <= INT64_T;
+		}
+
+		element_type get_element_type() const throw() {
+			return mType;
+		}
+
+		//! \brief Change the element type, existing elements are discarded
+		void set_element_type(const element_type aType) {
+			clear();
+			mType = aType;
+		}
+
+		size_t size() const throw() {
+			return mSize;
+		}
+
+		bool empty() const throw() {
+			return mSize == 0;
+		}
+
+		size_t size_in_bytes() const throw() {
+			return mSize * element_size(mType);
+		}
+
+		void* data() throw() {
+			return mWords.data();
+		}
+
+		const void* data() const throw() {
+			return mWords.data();
+		}
+
+		void reserve(const size_t aSize) {
+			mWords.reserve(words(mType, aSize));
+		}
+
+		//! \brief New elements are zero
+		void resize(const size_t aSize) {
+			mWords.resize(words(mType, aSize), 0);
+			if(aSize < mSize && aSize > 0) {
+				// Clear the tail of the last word so that the bytes past the end are always zero
+				const size_t bytes = aSize * element_size(mType);
+				std::memset(static_cast<char*>(data()) + bytes, 0, mWords.size() * sizeof(uint64_t) - bytes);
+			}
+			mSize = aSize;
+		}
+
+		void clear() throw() {
+			mWords.clear();
+			mSize = 0;
+		}
+
+		//! \brief Replace the contents with a copy of aSize elements of aType
+		void assign(const element_type aType, const void* aData, const size_t aSize) {
+			mWords.clear();
+			mSize = 0;
+			mType = aType;
+			resize(aSize);
+			if(aSize > 0) std::memcpy(data(), aData, size_in_bytes());
+		}
+
+		//! \brief Read an element converted to T with static_cast
+		template<class T>
+		T get(const size_t aIndex) const throw() {
+			switch(mType) {
+			case INT8_T:
+				return static_cast<T>(load<int8_t>(aIndex));
+			case INT16_T:
+				return static_cast<T>(load<int16_t>(aIndex));
+			case INT32_T:
+				return static_cast<T>(load<int32_t>(aIndex));
+			case INT64_T:
+				return static_cast<T>(load<int64_t>(aIndex));
+			case UINT8_T:
+				return static_cast<T>(load<uint8_t>(aIndex));
+			case UINT16_T:
+				return static_cast<T>(load<uint16_t>(aIndex));
+			case UINT32_T:
+				return static_cast<T>(load<uint32_t>(aIndex));
+			case UINT64_T:
+				return static_cast<T>(load<uint64_t>(aIndex));
+			case FLOAT_T:
+				return static_cast<T>(load<float>(aIndex));
+			default:
+				return static_cast<T>(load<double>(aIndex));
+			}
+		}
+
+		//! \brief Copy the first aSize elements converted to T, this is a memcpy when T is the element type
+		template<class T>
+		void copy_to(T* aOutput, const size_t aSize) const throw() {
+			if(static_cast<element_type>(packed_element<T>::type) == mType) {
+				if(aSize > 0) std::memcpy(aOutput, data(), aSize * sizeof(T));
+			}else {
+				for(size_t i = 0; i < aSize; ++i) aOutput[i] = get<T>(i);
+			}
+		}
+
+		bool operator==(const packed_array& aOther) const throw() {
+			if(mType != aOther.mType || mSize != aOther.mSize) return false;
+			if(is_floating_point(mType)) return equal_elements(aOther);
+			return mSize == 0 || std::memcmp(data(), aOther.data(), size_in_bytes()) == 0;
+		}
+
+		bool operator!=(const packed_array& aOther) const throw() {
+			return ! operator==(aOther);
+		}
+	private:
+		bool equal_elements(const packed_array& aOther) const throw() {
+			// Floating point elements compare by value, 0.0 == -0.0 and NaN != NaN
+			for(size_t i = 0; i < mSize; ++i) if(get<double>(i) != aOther.get<double>(i)) return false;
+			return true;
+		}
+	};
+
+	//! \brief Maps an arithmetic type to the packed_array element type that stores it
+	template<class T>
+	struct packed_element {
+		enum : bool { packable = false };
+	};
+
+	#define ASMITH_SERIAL_PACKED_ELEMENT(TYPE, ELEMENT)\
+	template<>\
+	struct packed_element<TYPE> {\
+		enum : bool { packable = true };\
+		enum : uint8_t { type = packed_array::ELEMENT };\
+	};
+
+	ASMITH_SERIAL_PACKED_ELEMENT(int8_t, INT8_T)
+	ASMITH_SERIAL_PACKED_ELEMENT(int16_t, INT16_T)
+	ASMITH_SERIAL_PACKED_ELEMENT(int32_t, INT32_T)
+	ASMITH_SERIAL_PACKED_ELEMENT(int64_t, INT64_T)
+	ASMITH_SERIAL_PACKED_ELEMENT(uint8_t, UINT8_T)
+	ASMITH_SERIAL_PACKED_ELEMENT(uint16_t, UINT16_T)
+	ASMITH_SERIAL_PACKED_ELEMENT(uint32_t, UINT32_T)
+	ASMITH_SERIAL_PACKED_ELEMENT(uint64_t, UINT64_T)
+	ASMITH_SERIAL_PACKED_ELEMENT(float, FLOAT_T)
+	ASMITH_SERIAL_PACKED_ELEMENT(double, DOUBLE_T)
+
+	#undef ASMITH_SERIAL_PACKED_ELEMENT
+}}
+
+#endif
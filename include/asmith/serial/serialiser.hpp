@@ -14,6 +14,7 @@
 #include <list>
 #include <deque>
 #include <array>
+#include <stdexcept>
 #include "value.hpp"
 
 #ifndef ASMITH_SERIAL_SERIALISER_HPP
@@ -56,6 +57,23 @@ namespace asmith { namespace serial {
 		return serialiser<T>::deserialise(aValue);
 	}
 
+	template<class T, class NODE>
+	auto deserialise_json(const NODE& aNode, int) -> decltype(serialiser<T>::deserialise_json(aNode)) {
+		return serialiser<T>::deserialise_json(aNode);
+	}
+
+	template<class T, class NODE>
+	typename serialiser<T>::output_t deserialise_json(const NODE& aNode, long) {
+		return serialiser<T>::deserialise(aNode.materialise());
+	}
+
+	//! \brief Deserialise directly from a json_node when the serialiser provides deserialise_json
+	//! \detail Serialisers without it are given the node as a value, so every type can be read this way.
+	template<class T, class NODE>
+	typename serialiser<T>::output_t deserialise_json(const NODE& aNode) {
+		return deserialise_json<T>(aNode, 0);
+	}
+
 
 
 
@@ -151,7 +169,7 @@ namespace asmith { namespace serial {
 				std::string tmp = n.substr(i+1);
 				tmp.pop_back();
 				n = n.substr(0, i);
-				const value::array_t& array_ = aValue.get_array();
+				const value::array_t array_ = aValue.as_array();
 				const size_t s = std::stoi(tmp.c_str());
 				if(s != array_.size()) throw std::runtime_error("asmith::reflection_serialise : Array length mismatch");
 				const reflection_class& cls = reflection_class::get_class_by_name(n.c_str());
@@ -167,14 +185,14 @@ namespace asmith { namespace serial {
 
 		if(strcmp(name, reflect<bool>().get_name()) == 0)			{ *reinterpret_cast<bool*>(aReturn) = (bool) aValue.get_bool(); return; }
 		else if(strcmp(name, reflect<char>().get_name()) == 0)		{ *reinterpret_cast<char*>(aReturn) = (char) aValue.get_char(); return; }
-		else if(strcmp(name, reflect<uint8_t>().get_name()) == 0)	{ *reinterpret_cast<uint8_t*>(aReturn) = (uint8_t) aValue.get_number(); return; }
-		else if(strcmp(name, reflect<uint16_t>().get_name()) == 0)	{ *reinterpret_cast<uint16_t*>(aReturn) = (uint16_t) aValue.get_number(); return; }
-		else if(strcmp(name, reflect<uint32_t>().get_name()) == 0)	{ *reinterpret_cast<uint32_t*>(aReturn) = (uint32_t)aValue.get_number(); return; }
-		else if(strcmp(name, reflect<uint64_t>().get_name()) == 0)	{ *reinterpret_cast<uint64_t*>(aReturn) = (uint64_t)aValue.get_number(); return; }
-		else if(strcmp(name, reflect<int8_t>().get_name()) == 0)	{ *reinterpret_cast<int8_t*>(aReturn) = (int8_t)aValue.get_number(); return; }
-		else if(strcmp(name, reflect<int16_t>().get_name()) == 0)	{ *reinterpret_cast<int16_t*>(aReturn) = (int16_t)aValue.get_number(); return; }
-		else if(strcmp(name, reflect<int32_t>().get_name()) == 0)	{ *reinterpret_cast<int32_t*>(aReturn) = (int32_t)aValue.get_number(); return; }
-		else if(strcmp(name, reflect<int64_t>().get_name()) == 0)	{ *reinterpret_cast<int64_t*>(aReturn) = (int64_t)aValue.get_number(); return; }
+		else if(strcmp(name, reflect<uint8_t>().get_name()) == 0)	{ *reinterpret_cast<uint8_t*>(aReturn) = (uint8_t) aValue.get_uint(); return; }
+		else if(strcmp(name, reflect<uint16_t>().get_name()) == 0)	{ *reinterpret_cast<uint16_t*>(aReturn) = (uint16_t) aValue.get_uint(); return; }
+		else if(strcmp(name, reflect<uint32_t>().get_name()) == 0)	{ *reinterpret_cast<uint32_t*>(aReturn) = (uint32_t)aValue.get_uint(); return; }
+		else if(strcmp(name, reflect<uint64_t>().get_name()) == 0)	{ *reinterpret_cast<uint64_t*>(aReturn) = (uint64_t)aValue.get_uint(); return; }
+		else if(strcmp(name, reflect<int8_t>().get_name()) == 0)	{ *reinterpret_cast<int8_t*>(aReturn) = (int8_t)aValue.get_int(); return; }
+		else if(strcmp(name, reflect<int16_t>().get_name()) == 0)	{ *reinterpret_cast<int16_t*>(aReturn) = (int16_t)aValue.get_int(); return; }
+		else if(strcmp(name, reflect<int32_t>().get_name()) == 0)	{ *reinterpret_cast<int32_t*>(aReturn) = (int32_t)aValue.get_int(); return; }
+		else if(strcmp(name, reflect<int64_t>().get_name()) == 0)	{ *reinterpret_cast<int64_t*>(aReturn) = (int64_t)aValue.get_int(); return; }
 		else if(strcmp(name, reflect<float>().get_name()) == 0)		{ *reinterpret_cast<float*>(aReturn) = (float) aValue.get_number(); return; }
 		else if(strcmp(name, reflect<double>().get_name()) == 0)	{ *reinterpret_cast<double*>(aReturn) = (double) aValue.get_number(); return; }
 		//! \todo Handle std::string, std::vector, ect
@@ -182,7 +200,7 @@ namespace asmith { namespace serial {
 		const size_t varCount = aCls.get_variable_count();
 		if(varCount == 0) return;
 
-		const value::object_t& object = aValue.get_object();
+		const value::object_t object = aValue.as_object();
 		for(size_t i = 0; i < varCount; ++i) {
 			const reflection_variable& var = aCls.get_variable(i);
 			const reflection_class& vCls = var.get_class();
@@ -213,6 +231,9 @@ namespace asmith { namespace serial {
 
 		static inline value serialise(input_t aValue) throw() { return value(aValue); }
 		static inline output_t deserialise(const value& aValue) throw() { return aValue.get_bool(); }
+
+		template<class NODE>
+		static inline output_t deserialise_json(const NODE& aNode) { return aNode.get_bool(); }
 	};
 
 	template<>
@@ -229,11 +250,37 @@ namespace asmith { namespace serial {
 		std::is_same<T, uint8_t>::value ||
 		std::is_same<T, uint16_t>::value ||
 		std::is_same<T, uint32_t>::value ||
-		std::is_same<T, uint64_t>::value ||
+		std::is_same<T, uint64_t>::value
+	>::type> {
+		typedef T input_t;
+		typedef T output_t;
+
+		static inline value serialise(input_t aValue) throw() { return value(aValue); }
+		static inline output_t deserialise(const value& aValue) throw() { return static_cast<T>(aValue.get_uint()); }
+
+		template<class NODE>
+		static inline output_t deserialise_json(const NODE& aNode) { return static_cast<T>(aNode.get_uint()); }
+	};
+
+	template<class T>
+	struct serialiser<T, typename std::enable_if<
 		std::is_same<T, int8_t>::value ||
 		std::is_same<T, int16_t>::value ||
 		std::is_same<T, int32_t>::value ||
-		std::is_same<T, int64_t>::value ||
+		std::is_same<T, int64_t>::value
+	>::type> {
+		typedef T input_t;
+		typedef T output_t;
+
+		static inline value serialise(input_t aValue) throw() { return value(aValue); }
+		static inline output_t deserialise(const value& aValue) throw() { return static_cast<T>(aValue.get_int()); }
+
+		template<class NODE>
+		static inline output_t deserialise_json(const NODE& aNode) { return static_cast<T>(aNode.get_int()); }
+	};
+
+	template<class T>
+	struct serialiser<T, typename std::enable_if<
 		std::is_same<T, float>::value ||
 		std::is_same<T, double>::value
 	>::type> {
@@ -242,6 +289,9 @@ namespace asmith { namespace serial {
 
 		static inline value serialise(input_t aValue) throw() { return value(aValue); }
 		static inline output_t deserialise(const value& aValue) throw() { return static_cast<T>(aValue.get_number()); }
+
+		template<class NODE>
+		static inline output_t deserialise_json(const NODE& aNode) { return static_cast<T>(aNode.get_number()); }
 	};
 
 	template<>
@@ -250,7 +300,23 @@ namespace asmith { namespace serial {
 		typedef std::string output_t;
 
 		static inline value serialise(input_t aValue) throw() { return value(aValue.c_str()); }
-		static inline output_t deserialise(const value& aValue) throw() { return aValue.get_string(); }
+		static inline output_t deserialise(const value& aValue) throw() {
+			if(aValue.get_type() == value::STRING_T) {
+				return aValue.get_string().str();
+			}
+			const value::string_t tmp = aValue.as_string();
+			return output_t(tmp.c_str(), tmp.size());
+		}
+
+		template<class NODE>
+		static output_t deserialise_json(const NODE& aNode) {
+			if(aNode.get_type() == value::STRING_T) {
+				output_t tmp;
+				aNode.get_string(tmp);
+				return tmp;
+			}
+			return deserialise(aNode.materialise());
+		}
 	};
 
 	template<class K, class T>
@@ -263,7 +329,7 @@ namespace asmith { namespace serial {
 			value tmp;
 			value::object_t& val = tmp.set_object();
 			for(const auto& i : aValue) {
-				val.emplace(i.first, serial::serialise<T>(i.second));
+				val.emplace(value::key_t(i.first.c_str(), i.first.size()), serial::serialise<T>(i.second));
 			}
 			return tmp;
 		}
@@ -286,9 +352,10 @@ namespace asmith { namespace serial {
 		template<class K2 = K>
 		static typename std::enable_if<std::is_same<K2, std::string>::value, output_t>::type deserialise(const value& aValue) {
 			output_t tmp;
-			const value::object_t& val = aValue.get_object();
+			value::object_t buf;
+			const value::object_t& val = aValue.get_type() == value::OBJECT_T ? aValue.get_object() : (buf = aValue.as_object());
 			for(const auto& i : val) {
-				tmp.emplace(i.first, serial::deserialise<T>(i.second));
+				tmp.emplace(K(i.first.c_str(), i.first.size()), serial::deserialise<T>(i.second));
 			}
 			return tmp;
 		}
@@ -296,25 +363,53 @@ namespace asmith { namespace serial {
 		template<class K2 = K>
 		static typename std::enable_if<!std::is_same<K2, std::string>::value, output_t>::type deserialise(const value& aValue) {
 			output_t tmp;
-			const value::object_t& val = aValue.get_object();
-			const value::array_t& keys = val.find("keys")->second.get_array();
-			const value::array_t& values = val.find("values")->second.get_array();
+			value::object_t buf;
+			const value::object_t& val = aValue.get_type() == value::OBJECT_T ? aValue.get_object() : (buf = aValue.as_object());
+			const value::array_t keys = val.find("keys")->second.as_array();
+			const value::array_t values = val.find("values")->second.as_array();
 			const size_t s = keys.size();
 			for(size_t i = 0; i < s; ++i) {
 				tmp.emplace(serial::deserialise<K>(keys[i]), serial::deserialise<T>(values[i]));
 			}
 			return tmp;
 		}
+
+		template<class NODE, class K2 = K>
+		static typename std::enable_if<std::is_same<K2, std::string>::value, output_t>::type deserialise_json(const NODE& aNode) {
+			if(aNode.get_type() != value::OBJECT_T) return deserialise(aNode.materialise());
+			output_t tmp;
+			K key;
+			for(auto i = aNode.begin(); i != aNode.end(); ++i) {
+				i.key(key);
+				tmp.emplace(key, serial::deserialise_json<T>(*i));
+			}
+			return tmp;
+		}
+
+		template<class NODE, class K2 = K>
+		static typename std::enable_if<!std::is_same<K2, std::string>::value, output_t>::type deserialise_json(const NODE& aNode) {
+			if(aNode.get_type() != value::OBJECT_T) return deserialise(aNode.materialise());
+			output_t tmp;
+			const NODE keys = aNode["keys"];
+			const NODE values = aNode["values"];
+			auto k = keys.begin();
+			auto v = values.begin();
+			for(; k != keys.end() && v != values.end(); ++k, ++v) {
+				tmp.emplace(serial::deserialise_json<K>(*k), serial::deserialise_json<T>(*v));
+			}
+			return tmp;
+		}
 	};
 
 	template<class T>
-	struct serialiser<std::vector<T>> {
+	struct serialiser<std::vector<T>, typename std::enable_if<! packed_element<T>::packable>::type> {
 		typedef const std::vector<T>& input_t;
 		typedef std::vector<T> output_t;
 
 		static value serialise(input_t aValue) throw() {
 			value tmp;
 			value::array_t& val = tmp.set_array();
+			val.reserve(aValue.size());
 			for(const T& i : aValue) {
 				val.push_back(serial::serialise<T>(i));
 			}
@@ -323,12 +418,68 @@ namespace asmith { namespace serial {
 
 		static output_t deserialise(const value& aValue) {
 			output_t tmp;
-			const value::array_t& val = aValue.get_array();
+			value::array_t buf;
+			const value::array_t& val = aValue.get_type() == value::ARRAY_T ? aValue.get_array() : (buf = aValue.as_array());
+			for(const value& i : val) {
+				tmp.push_back(serial::deserialise<T>(i));
+			}
+			return tmp;
+		}
+
+		template<class NODE>
+		static output_t deserialise_json(const NODE& aNode) {
+			const value::type type = aNode.get_type();
+			if(type != value::ARRAY_T && type != value::OBJECT_T) return deserialise(aNode.materialise());
+			output_t tmp;
+			tmp.reserve(aNode.size());
+			for(const NODE& i : aNode) {
+				tmp.push_back(serial::deserialise_json<T>(i));
+			}
+			return tmp;
+		}
+	};
+
+	//! \brief Vectors of numbers are stored in a packed array
+	template<class T>
+	struct serialiser<std::vector<T>, typename std::enable_if<packed_element<T>::packable>::type> {
+		typedef const std::vector<T>& input_t;
+		typedef std::vector<T> output_t;
+
+		static value serialise(input_t aValue) throw() {
+			value tmp;
+			tmp.set_packed_array().assign(static_cast<value::packed_array_t::element_type>(packed_element<T>::type), aValue.data(), aValue.size());
+			return tmp;
+		}
+
+		static output_t deserialise(const value& aValue) {
+			if(aValue.get_type() == value::PACKED_ARRAY_T) {
+				const value::packed_array_t& val = aValue.get_packed_array();
+				output_t tmp(val.size());
+				val.copy_to(tmp.data(), tmp.size());
+				return tmp;
+			}
+
+			output_t tmp;
+			value::array_t buf;
+			const value::array_t& val = aValue.get_type() == value::ARRAY_T ? aValue.get_array() : (buf = aValue.as_array());
+			tmp.reserve(val.size());
 			for(const value& i : val) {
 				tmp.push_back(serial::deserialise<T>(i));
 			}
 			return tmp;
 		}
+
+		template<class NODE>
+		static output_t deserialise_json(const NODE& aNode) {
+			const value::type type = aNode.get_type();
+			if(type != value::ARRAY_T && type != value::OBJECT_T) return deserialise(aNode.materialise());
+			output_t tmp;
+			tmp.reserve(aNode.size());
+			for(const NODE& i : aNode) {
+				tmp.push_back(serial::deserialise_json<T>(i));
+			}
+			return tmp;
+		}
 	};
 
 	template<class T>
@@ -347,12 +498,24 @@ namespace asmith { namespace serial {
 
 		static output_t deserialise(const value& aValue) {
 			output_t tmp;
-			const value::array_t& val = aValue.get_array();
+			value::array_t buf;
+			const value::array_t& val = aValue.get_type() == value::ARRAY_T ? aValue.get_array() : (buf = aValue.as_array());
 			for(const value& i : val) {
 				tmp.push_back(serial::deserialise<T>(i));
 			}
 			return tmp;
 		}
+
+		template<class NODE>
+		static output_t deserialise_json(const NODE& aNode) {
+			const value::type type = aNode.get_type();
+			if(type != value::ARRAY_T && type != value::OBJECT_T) return deserialise(aNode.materialise());
+			output_t tmp;
+			for(const NODE& i : aNode) {
+				tmp.push_back(serial::deserialise_json<T>(i));
+			}
+			return tmp;
+		}
 	};
 
 	template<class T>
@@ -371,36 +534,109 @@ namespace asmith { namespace serial {
 
 		static output_t deserialise(const value& aValue) {
 			output_t tmp;
-			const value::array_t& val = aValue.get_array();
+			value::array_t buf;
+			const value::array_t& val = aValue.get_type() == value::ARRAY_T ? aValue.get_array() : (buf = aValue.as_array());
 			for(const value& i : val) {
-				tmp.push_back(serial::deserialise<V>(i));
+				tmp.push_back(serial::deserialise<T>(i));
+			}
+			return tmp;
+		}
+
+		template<class NODE>
+		static output_t deserialise_json(const NODE& aNode) {
+			const value::type type = aNode.get_type();
+			if(type != value::ARRAY_T && type != value::OBJECT_T) return deserialise(aNode.materialise());
+			output_t tmp;
+			for(const NODE& i : aNode) {
+				tmp.push_back(serial::deserialise_json<T>(i));
 			}
 			return tmp;
 		}
 	};
 
 	template<class T, size_t S>
-	struct serialiser<std::array<T,S>> {
+	struct serialiser<std::array<T,S>, typename std::enable_if<! packed_element<T>::packable>::type> {
 		typedef const std::array<T,S>& input_t;
 		typedef std::array<T,S> output_t;
 
 		static value serialise(input_t aValue) throw() {
 			value tmp;
 			value::array_t& val = tmp.set_array();
+			val.reserve(S);
 			for(size_t i = 0; i < S; ++i) {
-				val.push_back(serial::serialise<T>(tmp[i]));
+				val.push_back(serial::serialise<T>(aValue[i]));
 			}
 			return tmp;
 		}
 
 		static output_t deserialise(const value& aValue) {
 			output_t tmp;
-			const value::array_t& val = aValue.get_array();
+			value::array_t buf;
+			const value::array_t& val = aValue.get_type() == value::ARRAY_T ? aValue.get_array() : (buf = aValue.as_array());
 			for(size_t i = 0; i < S; ++i) {
 				tmp[i] = serial::deserialise<T>(val[i]);
 			}
 			return tmp;
 		}
+
+		template<class NODE>
+		static output_t deserialise_json(const NODE& aNode) {
+			const value::type type = aNode.get_type();
+			if(type != value::ARRAY_T && type != value::OBJECT_T) return deserialise(aNode.materialise());
+			output_t tmp;
+			auto j = aNode.begin();
+			const auto end = aNode.end();
+			for(size_t i = 0; i < S; ++i, ++j) {
+				if(j == end) throw std::runtime_error("json_document : Index is out of bounds");
+				tmp[i] = serial::deserialise_json<T>(*j);
+			}
+			return tmp;
+		}
+	};
+
+	//! \brief Arrays of numbers are stored in a packed array
+	template<class T, size_t S>
+	struct serialiser<std::array<T,S>, typename std::enable_if<packed_element<T>::packable>::type> {
+		typedef const std::array<T,S>& input_t;
+		typedef std::array<T,S> output_t;
+
+		static value serialise(input_t aValue) throw() {
+			value tmp;
+			tmp.set_packed_array().assign(static_cast<value::packed_array_t::element_type>(packed_element<T>::type), aValue.data(), S);
+			return tmp;
+		}
+
+		static output_t deserialise(const value& aValue) {
+			output_t tmp;
+			if(aValue.get_type() == value::PACKED_ARRAY_T) {
+				const value::packed_array_t& val = aValue.get_packed_array();
+				if(val.size() < S) throw std::runtime_error("value : Index is out of bounds");
+				val.copy_to(tmp.data(), S);
+				return tmp;
+			}
+
+			value::array_t buf;
+			const value::array_t& val = aValue.get_type() == value::ARRAY_T ? aValue.get_array() : (buf = aValue.as_array());
+			if(val.size() < S) throw std::runtime_error("value : Index is out of bounds");
+			for(size_t i = 0; i < S; ++i) {
+				tmp[i] = serial::deserialise<T>(val[i]);
+			}
+			return tmp;
+		}
+
+		template<class NODE>
+		static output_t deserialise_json(const NODE& aNode) {
+			const value::type type = aNode.get_type();
+			if(type != value::ARRAY_T && type != value::OBJECT_T) return deserialise(aNode.materialise());
+			output_t tmp;
+			auto j = aNode.begin();
+			const auto end = aNode.end();
+			for(size_t i = 0; i < S; ++i, ++j) {
+				if(j == end) throw std::runtime_error("json_document : Index is out of bounds");
+				tmp[i] = serial::deserialise_json<T>(*j);
+			}
+			return tmp;
+		}
 	};
 
 	template<class A, class B>
@@ -418,11 +654,20 @@ namespace asmith { namespace serial {
 
 		static output_t deserialise(const value& aValue) {
 			output_t tmp;
-			const value::object_t& val = aValue.get_object();
+			value::object_t buf;
+			const value::object_t& val = aValue.get_type() == value::OBJECT_T ? aValue.get_object() : (buf = aValue.as_object());
 			tmp.first = serial::deserialise<A>(val.find("first")->second);
 			tmp.second = serial::deserialise<B>(val.find("second")->second);
 			return tmp;
 		}
+
+		template<class NODE>
+		static output_t deserialise_json(const NODE& aNode) {
+			output_t tmp;
+			tmp.first = serial::deserialise_json<A>(aNode["first"]);
+			tmp.second = serial::deserialise_json<B>(aNode["second"]);
+			return tmp;
+		}
 	};
 
 }}
@@ -14,11 +14,20 @@
 #ifndef ASMITH_SERIAL_VALUE_HPP
 #define ASMITH_SERIAL_VALUE_HPP
 
+#include <atomic>
+#include <cstring>
+#include <ostream>
 #include <string>
 #include <vector>
 #include <map>
+#include <utility>
+#include "arena.hpp"
+#include "flat_map.hpp"
+#include "key.hpp"
+#include "packed_array.hpp"
 	
 namespace asmith { namespace serial {
+	ASMITH_SERIAL_BEGIN_OBJECT_ABI
 
 	class value {
 	public:
@@ -26,9 +35,17 @@ namespace asmith { namespace serial {
 		typedef bool bool_t;
 		typedef char char_t;
 		typedef double number_t;
-		typedef std::string string_t;
-		typedef std::vector<value> array_t;
-		typedef std::map<std::string, value> object_t;
+		typedef int64_t int_t;
+		typedef uint64_t uint_t;
+		typedef std::basic_string<char, std::char_traits<char>, value_allocator<char>> string_t;
+		typedef interned_key key_t;
+		typedef std::vector<value, value_allocator<value>> array_t;
+		typedef packed_array packed_array_t;
+#ifdef ASMITH_SERIAL_FLAT_OBJECT
+		typedef flat_map<key_t, value, interned_key_hash, value_allocator<std::pair<key_t, value>>> object_t;
+#else
+		typedef std::map<key_t, value, std::less<key_t>, value_allocator<std::pair<const key_t, value>>> object_t;
+#endif
 		
 		enum type : uint8_t {
 			NULL_T,
@@ -37,18 +54,86 @@ namespace asmith { namespace serial {
 			NUMBER_T,
 			STRING_T,
 			ARRAY_T,
-			OBJECT_T
+			OBJECT_T,
+			INT_T,
+			UINT_T,
+			PACKED_ARRAY_T
+		};
+
+		enum : size_t {
+			//! \brief Strings up to this length are stored inside the value instead of being allocated
+			SHORT_STRING_CAPACITY = 14
+		};
+
+		//! \brief Characters of a string value, they are not null terminated
+		//! \detail Only valid until the value is modified or destroyed.
+		class string_ref {
+		private:
+			const char* mData;
+			size_t mSize;
+		public:
+			string_ref(const char* aData, const size_t aSize) throw() : mData(aData), mSize(aSize) {}
+			string_ref(const char* aData) throw() : mData(aData), mSize(std::strlen(aData)) {}
+			string_ref(const std::string& aString) throw() : mData(aString.data()), mSize(aString.size()) {}
+			string_ref(const string_t& aString) throw() : mData(aString.data()), mSize(aString.size()) {}
+
+			const char* data() const throw() { return mData; }
+			size_t size() const throw() { return mSize; }
+			bool empty() const throw() { return mSize == 0; }
+			const char* begin() const throw() { return mData; }
+			const char* end() const throw() { return mData + mSize; }
+			char front() const throw() { return *mData; }
+			char back() const throw() { return mData[mSize - 1]; }
+			char operator[](const size_t aIndex) const throw() { return mData[aIndex]; }
+
+			std::string str() const {
+				return std::string(mData, mSize);
+			}
+
+			bool operator==(const string_ref& aOther) const throw() {
+				return mSize == aOther.mSize && (mSize == 0 || std::memcmp(mData, aOther.mData, mSize) == 0);
+			}
+
+			bool operator!=(const string_ref& aOther) const throw() {
+				return ! operator==(aOther);
+			}
 		};
 	private:
+		enum : uint8_t {
+			ARENA_FLAG = 1,
+			SHARED_FLAG = 2,
+			SHORT_STRING_FLAG = 4,
+			SHORT_STRING_SHIFT = 4 //!< The length of a short string is stored in the high bits of mFlags
+		};
+
 		union {
 			bool_t mBool;
 			char_t mChar;
 			number_t mNumber;
+			int_t mInt;
+			uint_t mUint;
 			string_t* mString;
 			array_t* mArray;
 			object_t* mObject;
+			packed_array_t* mPackedArray;
 		};
+		//! \brief Short strings start in the union and continue into these bytes
+		char mShortStringTail[SHORT_STRING_CAPACITY - sizeof(uint64_t)];
 		type mType;
+		uint8_t mFlags;
+
+		char* short_string() throw();
+		const char* short_string() const throw();
+
+		//! \brief Move a shared payload into storage owned by this value
+		void detach();
+
+		//! \brief Copy or take the payload of aOther, this value must be null
+		void copy_from(const value&);
+		void move_from(value&) throw();
+
+		//! \brief Hash stored with a shared payload, null when the value is not shared
+		std::atomic<uint32_t>* cached_hash() const throw();
 	public:
 		value() throw();
 		value(const type) throw();
@@ -68,6 +153,7 @@ namespace asmith { namespace serial {
 		value(double) throw();
 		value(const char*) throw();
 		value(const std::string&) throw();
+		value(const string_t&) throw();
 		~value() throw();
 		
 		value& operator=(const value&) throw();
@@ -82,36 +168,102 @@ namespace asmith { namespace serial {
 		const value& operator[](const std::string&) const;
 
 		value& add_member(const std::string&, const value&);
+		value& add_member(const std::string&, value&&);
 		value remove_member(const std::string&);
 		value& push_back(const value&);
+		value& push_back(value&&);
 		value pop_back();
+		void reserve(const size_t);
 		void clear();
 
+		template<class... ARGS>
+		value& emplace_member(const std::string& aKey, ARGS&&... aArgs) {
+			return add_member(aKey, value(std::forward<ARGS>(aArgs)...));
+		}
+
+		template<class... ARGS>
+		value& emplace_back(ARGS&&... aArgs) {
+			array_t& array_ = get_array();
+			array_.emplace_back(std::forward<ARGS>(aArgs)...);
+			return array_.back();
+		}
+
 		size_t size() const throw();
 		type get_type() const throw();
+
+		//! \brief Move string, array and object payloads in this tree into reference counted copy-on-write storage
+		//! \detail Copies of a shared value are O(1) until one of them is accessed through a non-const member, which
+		//! moves or copies the payload back into storage owned by that value.
+		//! Short strings and arena backed values are left as they are.
+		void share();
+		bool is_shared() const throw();
+
+		//! \brief Structural hash of this tree, consistent with operator==
+		//! \detail The result is only cached for shared values, which stop being shared when they are accessed
+		//! through a non-const member. Other values are hashed again on every call, share() a tree that is hashed
+		//! repeatedly.
+		size_t hash() const throw();
 		
 		void set_null() throw();
 		bool_t& set_bool() throw();
 		char_t& set_char() throw();
 		number_t& set_number() throw();
+		int_t& set_int() throw();
+		uint_t& set_uint() throw();
+		//! \brief Allocate a string outside of the value, prefer set_string(const char*, size_t) for short strings
 		string_t& set_string() throw();
+		//! \brief Copy a string, strings up to SHORT_STRING_CAPACITY characters do not allocate
+		void set_string(const char*, const size_t) throw();
 		array_t& set_array() throw();
 		object_t& set_object() throw();
+		packed_array_t& set_packed_array() throw();
 		
 		bool_t& get_bool() throw();
 		char_t& get_char() throw();
 		number_t& get_number() throw();
+		int_t& get_int() throw();
+		uint_t& get_uint() throw();
+		//! \brief Short strings are moved out of the value so that a reference can be returned
 		string_t& get_string() throw();
 		array_t& get_array() throw();
 		object_t& get_object() throw();
+		packed_array_t& get_packed_array() throw();
 		
 		bool_t get_bool() const;
 		char_t get_char() const;
 		number_t get_number() const;
-		const string_t& get_string() const;
+		int_t get_int() const;
+		uint_t get_uint() const;
+		string_ref get_string() const;
+		//! \throw std::runtime_error If the value is a packed array, the non-const overload unpacks it instead
 		const array_t& get_array() const;
 		const object_t& get_object() const;
+		const packed_array_t& get_packed_array() const;
+
+		string_t as_string() const;
+		array_t as_array() const;
+		object_t as_object() const;
+
+		//! \brief Convert an array of numbers to a packed array
+		//! \detail Arrays of only signed or only unsigned integers keep 64 bit integer elements, any other mix of
+		//! numbers is stored as doubles.
+		packed_array_t as_packed_array() const;
 	};
+
+	inline std::ostream& operator<<(std::ostream& aStream, const value::string_ref& aString) {
+		return aStream.write(aString.data(), aString.size());
+	}
+
+	ASMITH_SERIAL_END_OBJECT_ABI
 }}
 
+namespace std {
+	template<>
+	struct hash<asmith::serial::value> {
+		size_t operator()(const asmith::serial::value& aValue) const throw() {
+			return aValue.hash();
+		}
+	};
+}
+
 #endif
\ No newline at end of file
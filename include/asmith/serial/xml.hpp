@@ -18,6 +18,9 @@
 	
 namespace asmith { namespace serial {
 	class xml_format : public format {
+	public:
+		using format::read_serial;
+
 		void write_serial(const value&, std::ostream&) override;
 		value read_serial(std::istream&) override;
 	};
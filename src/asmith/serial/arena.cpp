@@ -0,0 +1,105 @@
+//	Copyright 2017 Adam Smith
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+// 
+//	http://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+
+#include "asmith/serial/arena.hpp"
+#include <cstdlib>
+	
+namespace asmith { namespace serial {
+
+	static thread_local value_arena* SV_CURRENT_ARENA = nullptr;
+
+	// value_arena::scope
+
+	value_arena::scope::scope(value_arena& aArena) throw() :
+		mPrevious(SV_CURRENT_ARENA)
+	{
+		SV_CURRENT_ARENA = &aArena;
+	}
+
+	value_arena::scope::scope(value_arena* aArena) throw() :
+		mPrevious(SV_CURRENT_ARENA)
+	{
+		SV_CURRENT_ARENA = aArena;
+	}
+
+	value_arena::scope::~scope() throw() {
+		SV_CURRENT_ARENA = mPrevious;
+	}
+
+	// value_arena
+
+	value_arena::value_arena(size_t aBlockSize) throw() :
+		mHead(nullptr),
+		mPosition(nullptr),
+		mEnd(nullptr),
+		mBlockSize(aBlockSize),
+		mAllocated(0)
+	{}
+
+	value_arena::~value_arena() throw() {
+		while(mHead) {
+			block* const next = mHead->next;
+			std::free(mHead);
+			mHead = next;
+		}
+	}
+
+	void* value_arena::allocate(size_t aBytes, size_t aAlignment) {
+		uintptr_t address = reinterpret_cast<uintptr_t>(mPosition);
+		address = (address + aAlignment - 1) & ~static_cast<uintptr_t>(aAlignment - 1);
+
+		if(mHead == nullptr || address + aBytes > reinterpret_cast<uintptr_t>(mEnd)) {
+			// Start a new block, oversized requests get a block of their own
+			const size_t capacity = aBytes + aAlignment > mBlockSize ? aBytes + aAlignment : mBlockSize;
+			block* const b = static_cast<block*>(std::malloc(sizeof(block) + capacity));
+			if(b == nullptr) throw std::bad_alloc();
+			b->next = mHead;
+			b->capacity = capacity;
+			mHead = b;
+			mPosition = reinterpret_cast<uint8_t*>(b + 1);
+			mEnd = mPosition + capacity;
+
+			address = reinterpret_cast<uintptr_t>(mPosition);
+			address = (address + aAlignment - 1) & ~static_cast<uintptr_t>(aAlignment - 1);
+		}
+
+		mPosition = reinterpret_cast<uint8_t*>(address + aBytes);
+		mAllocated += aBytes;
+		return reinterpret_cast<void*>(address);
+	}
+
+	void value_arena::release() throw() {
+		if(mHead == nullptr) return;
+
+		// Keep the most recent block so that repeated parse / release cycles do not return to malloc
+		block* i = mHead->next;
+		while(i) {
+			block* const next = i->next;
+			std::free(i);
+			i = next;
+		}
+
+		mHead->next = nullptr;
+		mPosition = reinterpret_cast<uint8_t*>(mHead + 1);
+		mEnd = mPosition + mHead->capacity;
+		mAllocated = 0;
+	}
+
+	size_t value_arena::size() const throw() {
+		return mAllocated;
+	}
+
+	value_arena* value_arena::get_current() throw() {
+		return SV_CURRENT_ARENA;
+	}
+}}
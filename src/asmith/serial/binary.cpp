@@ -2,7 +2,7 @@
 //	Licensed under the Apache License, Version 2.0 (the "License");
 //	you may not use this file except in compliance with the License.
 //	You may obtain a copy of the License at
-// 
+//
 //	http://www.apache.org/licenses/LICENSE-2.0
 //
 //	Unless required by applicable law or agreed to in writing, software
@@ -12,140 +12,1382 @@
 //	limitations under the License.
 
 #include "asmith/serial/binary.hpp"
-	
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <istream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
 namespace asmith { namespace serial {
-	void binary_format::write_serial(const value& aType, std::ostream& aStream) {
-		const value::type tBuf = aType.get_type();
-		aStream.write(reinterpret_cast<const char*>(&tBuf), sizeof(tBuf));
-	
-		switch(tBuf) {
+
+	enum : size_t {
+		BINARY_MAX_VARINT = 10, //!< Bytes needed for a 64 bit LEB128 number
+		BINARY_MAX_RESERVE = 64 * 1024, //!< Lengths are not trusted beyond this until the data has been read
+		BINARY_STRING_BLOCK = 1024 * 1024,
+		BINARY_MAX_DEPTH = 512 //!< Arrays and objects nested deeper than this are treated as a corrupt document
+	};
+
+	//! \brief Magic number, version and flags written at the start of every document
+	//! \detail Version 1 documents have no header and begin with a type tag, which is never above UINT_T.
+	static const char BINARY_MAGIC[3] = {'A', 'S', 'B'};
+
+	enum : uint8_t {
+		BINARY_INDEXED = 1, //!< Arrays and objects are followed by a table of 64 bit offsets from the start of the document
+		BINARY_KEY_DICTIONARY = 2, //!< Names are listed after the header and members refer to them by index
+		BINARY_COLUMNAR = 4, //!< Arrays of objects may be written as columns
+		BINARY_FLAGS = BINARY_INDEXED | BINARY_KEY_DICTIONARY | BINARY_COLUMNAR
+	};
+
+	enum : uint8_t {
+		BINARY_COLUMNS = value::PACKED_ARRAY_T + 1, //!< Tag of a columnar array, followed by the row count and an object of columns
+		BINARY_GENERIC_COLUMN = 0xFF //!< Column that is written as an array because its values are not numbers of one type
+	};
+
+	enum : size_t {
+		BINARY_HEADER_SIZE = sizeof(BINARY_MAGIC) + 2,
+		BINARY_OFFSET_SIZE = sizeof(uint64_t),
+		BINARY_MIN_COLUMNAR_ROWS = 2
+	};
+
+	static size_t binary_varint_size(uint64_t aValue) throw() {
+		size_t size = 1;
+		while(aValue >= 0x80) {
+			aValue >>= 7;
+			++size;
+		}
+		return size;
+	}
+
+	//! \brief Size of a value that is not an array or object, packed arrays have no offset table
+	static uint64_t binary_scalar_size(const value& aValue) {
+		switch(aValue.get_type()) {
 		case value::NULL_T:
-			break;
+			return 1;
 		case value::BOOL_T:
-			{
-				const value::bool_t buf = aType.get_bool();
-				aStream.write(reinterpret_cast<const char*>(&buf), sizeof(buf));
-			}
-			break;
+			return 1 + sizeof(value::bool_t);
 		case value::CHAR_T:
+			return 1 + sizeof(value::char_t);
+		case value::NUMBER_T:
+			return 1 + sizeof(value::number_t);
+		case value::INT_T:
+			return 1 + sizeof(value::int_t);
+		case value::UINT_T:
+			return 1 + sizeof(value::uint_t);
+		case value::STRING_T:
 			{
-				const value::char_t buf = aType.get_char();
-				aStream.write(reinterpret_cast<const char*>(&buf), sizeof(buf));
+				const size_t size = aValue.get_string().size();
+				return 1 + binary_varint_size(size) + size;
 			}
-			break;
-		case value::NUMBER_T:
+		case value::PACKED_ARRAY_T:
 			{
-				const value::number_t buf = aType.get_number();
-				aStream.write(reinterpret_cast<const char*>(&buf), sizeof(buf));
+				const value::packed_array_t& tmp = aValue.get_packed_array();
+				return 2 + binary_varint_size(tmp.size()) + tmp.size_in_bytes();
 			}
-			break;
-		case value::STRING_T:
+		default:
+			throw std::runtime_error("binary_format : Invalid serial type");
+		}
+	}
+
+	static bool binary_is_container(const value& aValue) throw() {
+		const value::type type = aValue.get_type();
+		return type == value::ARRAY_T || type == value::OBJECT_T;
+	}
+
+	//! \brief An array of objects that have the same members, written as one column per member
+	struct binary_table {
+		std::vector<const value::key_t*> keys;
+		std::vector<uint8_t> types; //!< Packed element type of each column, or BINARY_GENERIC_COLUMN
+		std::vector<const value*> cells; //!< Member values in column order, so that each column is contiguous
+		size_t rows;
+
+		const value* const* column(const size_t aColumn) const throw() {
+			return cells.data() + aColumn * rows;
+		}
+	};
+
+	//! \brief Find every member of every element once, or return false if the elements do not all have the same members
+	static bool binary_collect_table(const value::array_t& aArray, binary_table& aTable) {
+		if(aArray.size() < BINARY_MIN_COLUMNAR_ROWS) return false;
+		const value& first = aArray.front();
+		if(first.get_type() != value::OBJECT_T || first.size() == 0) return false;
+		const value::object_t& members = first.get_object();
+		const size_t rows = aArray.size();
+		const size_t columns = members.size();
+
+		aTable.rows = rows;
+		aTable.keys.clear();
+		aTable.keys.reserve(columns);
+		for(const auto& i : members) aTable.keys.push_back(&i.first);
+		aTable.cells.resize(rows * columns);
+		for(size_t i = 0; i < rows; ++i) {
+			const value& row = aArray[i];
+			if(row.get_type() != value::OBJECT_T || row.size() != columns) return false;
+			const value::object_t& object = row.get_object();
+			for(size_t j = 0; j < columns; ++j) {
+				const auto k = object.find(*aTable.keys[j]);
+				if(k == object.end()) return false;
+				aTable.cells[j * rows + i] = &k->second;
+			}
+		}
+		return true;
+	}
+
+	//! \brief The smallest packed element type that holds every value of a column exactly, or BINARY_GENERIC_COLUMN
+	static uint8_t binary_column_type(const value* const* aCells, const size_t aRows) {
+		const value::type type = aCells[0]->get_type();
+		if(type != value::NUMBER_T && type != value::INT_T && type != value::UINT_T) return BINARY_GENERIC_COLUMN;
+
+		bool single = true;
+		value::int_t min = 0;
+		value::int_t max = 0;
+		value::uint_t umax = 0;
+		for(size_t i = 0; i < aRows; ++i) {
+			const value& element = *aCells[i];
+			if(element.get_type() != type) return BINARY_GENERIC_COLUMN;
+			switch(type) {
+			case value::NUMBER_T:
+				{
+					const value::number_t tmp = element.get_number();
+					if(! (std::fabs(tmp) <= FLT_MAX && static_cast<value::number_t>(static_cast<float>(tmp)) == tmp)) single = false;
+				}
+				break;
+			case value::INT_T:
+				min = std::min(min, element.get_int());
+				max = std::max(max, element.get_int());
+				break;
+			default:
+				umax = std::max(umax, element.get_uint());
+				break;
+			}
+		}
+
+		switch(type) {
+		case value::NUMBER_T:
+			return single ? packed_array::FLOAT_T : packed_array::DOUBLE_T;
+		case value::INT_T:
+			if(min >= INT8_MIN && max <= INT8_MAX) return packed_array::INT8_T;
+			if(min >= INT16_MIN && max <= INT16_MAX) return packed_array::INT16_T;
+			if(min >= INT32_MIN && max <= INT32_MAX) return packed_array::INT32_T;
+			return packed_array::INT64_T;
+		default:
+			if(umax <= UINT8_MAX) return packed_array::UINT8_T;
+			if(umax <= UINT16_MAX) return packed_array::UINT16_T;
+			if(umax <= UINT32_MAX) return packed_array::UINT32_T;
+			return packed_array::UINT64_T;
+		}
+	}
+
+	static value binary_packed_element(const value::packed_array_t& aArray, const size_t aIndex) {
+		const packed_array::element_type type = aArray.get_element_type();
+		if(packed_array::is_floating_point(type)) return value(aArray.get<value::number_t>(aIndex));
+		if(packed_array::is_signed(type)) return value(aArray.get<value::int_t>(aIndex));
+		return value(aArray.get<value::uint_t>(aIndex));
+	}
+
+	//! \brief Add each element of a column to the object in the same row
+	static void binary_scatter_column(value::array_t& aRows, const value::key_t& aKey, value& aColumn) {
+		const size_t s = aRows.size();
+		if(aColumn.size() != s) throw std::runtime_error("binary_format : Column length does not match the number of rows");
+		switch(aColumn.get_type()) {
+		case value::PACKED_ARRAY_T:
 			{
-			const value::string_t tmp = aType.get_string();
-			const uint16_t buf = static_cast<uint16_t>(tmp.size());
-				aStream.write(reinterpret_cast<const char*>(&buf), sizeof(buf));
-				aStream.write(tmp.c_str(), buf);
+				const value::packed_array_t& packed = aColumn.get_packed_array();
+				for(size_t i = 0; i < s; ++i) aRows[i].get_object().emplace(aKey, binary_packed_element(packed, i));
 			}
 			break;
 		case value::ARRAY_T:
 			{
-				const value::array_t tmp = aType.get_array();
-				const uint16_t buf = static_cast<uint16_t>(tmp.size());
-				aStream.write(reinterpret_cast<const char*>(&buf), sizeof(buf));
-				for(uint16_t i = 0; i < buf; ++i) write_serial(tmp[i], aStream);
+				value::array_t& array_ = aColumn.get_array();
+				for(size_t i = 0; i < s; ++i) aRows[i].get_object().emplace(aKey, std::move(array_[i]));
 			}
 			break;
+		default:
+			throw std::runtime_error("binary_format : Invalid column table");
+		}
+	}
+
+	//! \brief Writes a value tree into a buffer that is passed to the stream in large chunks
+	class binary_writer {
+	private:
+		enum : size_t {
+			BUFFER_SIZE = 64 * 1024
+		};
+
+		//! \brief Encoded size of a container and the number of containers in it, including itself
+		struct layout {
+			uint64_t size;
+			size_t containers;
+		};
+
+		typedef std::vector<std::pair<const value::key_t*, uint64_t>> member_table;
+
+		std::ostream& mStream;
+		std::unique_ptr<char[]> mBuffer;
+		char* mPosition;
+		char* const mEnd;
+		uint64_t mFlushed;
+		std::vector<layout> mLayout; //!< Every container of an indexed document, in the order they are written
+		size_t mNextLayout;
+		std::unordered_map<value::key_t, uint64_t, interned_key_hash> mKeyIndices;
+		std::vector<value::key_t> mKeys;
+		std::unordered_map<const value*, binary_table> mTables; //!< Arrays that are written as columns
+		const bool mIndexed;
+		const bool mKeyDictionary;
+		const bool mColumnar;
+
+		void put(const char aChar) {
+			if(mPosition == mEnd) flush();
+			*(mPosition++) = aChar;
+		}
+
+		void write(const void* aData, const size_t aSize) {
+			if(static_cast<size_t>(mEnd - mPosition) < aSize) {
+				flush();
+				if(aSize >= BUFFER_SIZE) {
+					mStream.write(static_cast<const char*>(aData), static_cast<std::streamsize>(aSize));
+					mFlushed += aSize;
+					return;
+				}
+			}
+			// An empty packed array has no data, and memcpy must not be given a null pointer
+			if(aSize == 0) return;
+			std::memcpy(mPosition, aData, aSize);
+			mPosition += aSize;
+		}
+
+		template<class T>
+		void write_raw(const T aValue) {
+			write(&aValue, sizeof(T));
+		}
+
+		void write_varint(uint64_t aValue) {
+			if(static_cast<size_t>(mEnd - mPosition) < BINARY_MAX_VARINT) flush();
+			while(aValue >= 0x80) {
+				*(mPosition++) = static_cast<char>(aValue | 0x80);
+				aValue >>= 7;
+			}
+			*(mPosition++) = static_cast<char>(aValue);
+		}
+
+		void write_string(const char* aData, const size_t aSize) {
+			write_varint(aSize);
+			write(aData, aSize);
+		}
+
+		void collect_keys(const value& aValue) {
+			if(aValue.get_type() == value::ARRAY_T) {
+				for(const value& i : aValue.get_array()) collect_keys(i);
+			}else if(aValue.get_type() == value::OBJECT_T) {
+				for(const auto& i : aValue.get_object()) {
+					if(mKeyIndices.emplace(i.first, mKeys.size()).second) mKeys.push_back(i.first);
+					collect_keys(i.second);
+				}
+			}
+		}
+
+		void collect_tables(const value& aValue) {
+			if(aValue.get_type() == value::ARRAY_T) {
+				const value::array_t& array_ = aValue.get_array();
+				binary_table table;
+				if(binary_collect_table(array_, table)) {
+					const size_t columns = table.keys.size();
+					table.types.resize(columns);
+					for(size_t i = 0; i < columns; ++i) table.types[i] = binary_column_type(table.column(i), table.rows);
+					mTables.emplace(&aValue, std::move(table));
+				}
+				for(const value& i : array_) collect_tables(i);
+			}else if(aValue.get_type() == value::OBJECT_T) {
+				for(const auto& i : aValue.get_object()) collect_tables(i.second);
+			}
+		}
+
+		void write_key_dictionary() {
+			write_varint(mKeys.size());
+			if(mIndexed) {
+				uint64_t offset = position() + mKeys.size() * BINARY_OFFSET_SIZE;
+				for(const value::key_t& i : mKeys) {
+					write_raw<uint64_t>(offset);
+					offset += binary_varint_size(i.size()) + i.size();
+				}
+			}
+			for(const value::key_t& i : mKeys) write_string(i.c_str(), i.size());
+		}
+
+		uint64_t key_size(const value::key_t& aKey) const {
+			if(mKeyDictionary) return binary_varint_size(mKeyIndices.find(aKey)->second);
+			return binary_varint_size(aKey.size()) + aKey.size();
+		}
+
+		void write_key(const value::key_t& aKey) {
+			if(mKeyDictionary) write_varint(mKeyIndices.find(aKey)->second);
+			else write_string(aKey.c_str(), aKey.size());
+		}
+
+		uint64_t position() const throw() {
+			return mFlushed + static_cast<uint64_t>(mPosition - mBuffer.get());
+		}
+
+		//! \brief Size of a value that has already been measured, aLayout is advanced past its containers
+		uint64_t measured_size(const value& aValue, size_t& aLayout) const {
+			if(! binary_is_container(aValue)) return binary_scalar_size(aValue);
+			const layout& tmp = mLayout[aLayout];
+			aLayout += tmp.containers;
+			return tmp.size;
+		}
+
+		uint64_t measured_column_size(const binary_table& aTable, const size_t aColumn, size_t& aLayout) const {
+			const uint8_t type = aTable.types[aColumn];
+			if(type != BINARY_GENERIC_COLUMN) {
+				return 2 + binary_varint_size(aTable.rows) + aTable.rows * packed_array::element_size(static_cast<packed_array::element_type>(type));
+			}
+			const layout& tmp = mLayout[aLayout];
+			aLayout += tmp.containers;
+			return tmp.size;
+		}
+
+		uint64_t measure_column(const binary_table& aTable, const size_t aColumn) {
+			if(aTable.types[aColumn] != BINARY_GENERIC_COLUMN) {
+				size_t layout = 0;
+				return measured_column_size(aTable, aColumn, layout);
+			}
+			const size_t index = mLayout.size();
+			mLayout.push_back(layout());
+			uint64_t size = 1 + binary_varint_size(aTable.rows) + aTable.rows * BINARY_OFFSET_SIZE;
+			const value* const* const cells = aTable.column(aColumn);
+			for(size_t i = 0; i < aTable.rows; ++i) size += measure(*cells[i]);
+			mLayout[index].size = size;
+			mLayout[index].containers = mLayout.size() - index;
+			return size;
+		}
+
+		//! \brief Size of a columnar array without its tag, the columns are laid out as an object
+		uint64_t measure_table(const binary_table& aTable) {
+			const size_t index = mLayout.size();
+			mLayout.push_back(layout());
+			const size_t columns = aTable.keys.size();
+			uint64_t size = 1 + binary_varint_size(columns) + columns * BINARY_OFFSET_SIZE;
+			for(size_t i = 0; i < columns; ++i) size += key_size(*aTable.keys[i]) + measure_column(aTable, i);
+			mLayout[index].size = size;
+			mLayout[index].containers = mLayout.size() - index;
+			return binary_varint_size(aTable.rows) + size;
+		}
+
+		uint64_t measure(const value& aValue) {
+			if(! binary_is_container(aValue)) return binary_scalar_size(aValue);
+			const size_t index = mLayout.size();
+			mLayout.push_back(layout());
+			const size_t count = aValue.size();
+			uint64_t size = 1 + binary_varint_size(count) + count * BINARY_OFFSET_SIZE;
+			const auto table = mTables.find(&aValue);
+			if(table != mTables.end()) {
+				size = 1 + measure_table(table->second);
+			}else if(aValue.get_type() == value::ARRAY_T) {
+				for(const value& i : aValue.get_array()) size += measure(i);
+			}else {
+				for(const auto& i : aValue.get_object()) {
+					size += key_size(i.first) + measure(i.second);
+				}
+			}
+			mLayout[index].size = size;
+			mLayout[index].containers = mLayout.size() - index;
+			return size;
+		}
+
+		void write_array_table(const value::array_t& aArray) {
+			uint64_t offset = position() + aArray.size() * BINARY_OFFSET_SIZE;
+			size_t layout = mNextLayout;
+			for(const value& i : aArray) {
+				write_raw<uint64_t>(offset);
+				offset += measured_size(i, layout);
+			}
+		}
+
+		void write_object_table(const value::object_t& aObject) {
+			// Members are written in the order of the object, the table is sorted by name for binary search
+			member_table members;
+			members.reserve(aObject.size());
+			uint64_t offset = position() + aObject.size() * BINARY_OFFSET_SIZE;
+			size_t layout = mNextLayout;
+			for(const auto& i : aObject) {
+				members.push_back(std::make_pair(&i.first, offset));
+				offset += key_size(i.first) + measured_size(i.second, layout);
+			}
+			write_member_table(members);
+		}
+
+		void write_column_table(const binary_table& aTable) {
+			const size_t columns = aTable.keys.size();
+			member_table members;
+			members.reserve(columns);
+			uint64_t offset = position() + columns * BINARY_OFFSET_SIZE;
+			size_t layout = mNextLayout;
+			for(size_t i = 0; i < columns; ++i) {
+				members.push_back(std::make_pair(aTable.keys[i], offset));
+				offset += key_size(*aTable.keys[i]) + measured_column_size(aTable, i, layout);
+			}
+			write_member_table(members);
+		}
+
+		void write_member_table(member_table& aMembers) {
+			std::sort(aMembers.begin(), aMembers.end(), [](const std::pair<const value::key_t*, uint64_t>& a, const std::pair<const value::key_t*, uint64_t>& b)->bool {
+				return *a.first < *b.first;
+			});
+			for(const auto& i : aMembers) write_raw<uint64_t>(i.second);
+		}
+
+		template<class T>
+		void write_packed_column(const value* const* aCells, const size_t aRows) {
+			for(size_t i = 0; i < aRows; ++i) {
+				const value& element = *aCells[i];
+				switch(element.get_type()) {
+				case value::INT_T:
+					write_raw<T>(static_cast<T>(element.get_int()));
+					break;
+				case value::UINT_T:
+					write_raw<T>(static_cast<T>(element.get_uint()));
+					break;
+				default:
+					write_raw<T>(static_cast<T>(element.get_number()));
+					break;
+				}
+			}
+		}
+
+		void write_column(const binary_table& aTable, const size_t aColumn) {
+			const value* const* const cells = aTable.column(aColumn);
+			const size_t rows = aTable.rows;
+			const uint8_t type = aTable.types[aColumn];
+			if(type == BINARY_GENERIC_COLUMN) {
+				put(static_cast<char>(value::ARRAY_T));
+				write_varint(rows);
+				if(mIndexed) {
+					++mNextLayout;
+					uint64_t offset = position() + rows * BINARY_OFFSET_SIZE;
+					size_t layout = mNextLayout;
+					for(size_t i = 0; i < rows; ++i) {
+						write_raw<uint64_t>(offset);
+						offset += measured_size(*cells[i], layout);
+					}
+				}
+				for(size_t i = 0; i < rows; ++i) write_value(*cells[i]);
+				return;
+			}
+
+			put(static_cast<char>(value::PACKED_ARRAY_T));
+			put(static_cast<char>(type));
+			write_varint(rows);
+			switch(type) {
+			case packed_array::INT8_T:
+				write_packed_column<int8_t>(cells, rows);
+				break;
+			case packed_array::INT16_T:
+				write_packed_column<int16_t>(cells, rows);
+				break;
+			case packed_array::INT32_T:
+				write_packed_column<int32_t>(cells, rows);
+				break;
+			case packed_array::INT64_T:
+				write_packed_column<int64_t>(cells, rows);
+				break;
+			case packed_array::UINT8_T:
+				write_packed_column<uint8_t>(cells, rows);
+				break;
+			case packed_array::UINT16_T:
+				write_packed_column<uint16_t>(cells, rows);
+				break;
+			case packed_array::UINT32_T:
+				write_packed_column<uint32_t>(cells, rows);
+				break;
+			case packed_array::UINT64_T:
+				write_packed_column<uint64_t>(cells, rows);
+				break;
+			case packed_array::FLOAT_T:
+				write_packed_column<float>(cells, rows);
+				break;
+			default:
+				write_packed_column<double>(cells, rows);
+				break;
+			}
+		}
+
+		void write_table(const binary_table& aTable) {
+			const size_t columns = aTable.keys.size();
+			put(static_cast<char>(BINARY_COLUMNS));
+			write_varint(aTable.rows);
+			put(static_cast<char>(value::OBJECT_T));
+			write_varint(columns);
+			if(mIndexed) {
+				mNextLayout += 2;
+				write_column_table(aTable);
+			}
+			for(size_t i = 0; i < columns; ++i) {
+				write_key(*aTable.keys[i]);
+				write_column(aTable, i);
+			}
+		}
+	public:
+		binary_writer(std::ostream& aStream, const bool aIndexed, const bool aKeyDictionary, const bool aColumnar) :
+			mStream(aStream),
+			mBuffer(new char[BUFFER_SIZE]),
+			mPosition(mBuffer.get()),
+			mEnd(mBuffer.get() + BUFFER_SIZE),
+			mFlushed(0),
+			mNextLayout(0),
+			mIndexed(aIndexed),
+			mKeyDictionary(aKeyDictionary),
+			mColumnar(aColumnar)
+		{}
+
+		void flush() {
+			if(mPosition != mBuffer.get()) {
+				mStream.write(mBuffer.get(), mPosition - mBuffer.get());
+				mFlushed += static_cast<uint64_t>(mPosition - mBuffer.get());
+				mPosition = mBuffer.get();
+			}
+		}
+
+		void write_header(const value& aValue) {
+			write(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+			put(static_cast<char>(binary_format::VERSION));
+			put((mIndexed ? BINARY_INDEXED : 0) | (mKeyDictionary ? BINARY_KEY_DICTIONARY : 0) | (mColumnar ? BINARY_COLUMNAR : 0));
+			mTables.clear();
+			if(mColumnar) collect_tables(aValue);
+			if(mKeyDictionary) {
+				mKeyIndices.clear();
+				mKeys.clear();
+				collect_keys(aValue);
+				write_key_dictionary();
+			}
+			if(mIndexed) {
+				mLayout.clear();
+				measure(aValue);
+				mNextLayout = 0;
+			}
+		}
+
+		void write_value(const value& aValue) {
+			if(! mTables.empty() && aValue.get_type() == value::ARRAY_T) {
+				const auto table = mTables.find(&aValue);
+				if(table != mTables.end()) {
+					write_table(table->second);
+					return;
+				}
+			}
+
+			const value::type type = aValue.get_type();
+			put(static_cast<char>(type));
+
+			switch(type) {
+			case value::NULL_T:
+				break;
+			case value::BOOL_T:
+				write_raw<value::bool_t>(aValue.get_bool());
+				break;
+			case value::CHAR_T:
+				write_raw<value::char_t>(aValue.get_char());
+				break;
+			case value::NUMBER_T:
+				write_raw<value::number_t>(aValue.get_number());
+				break;
+			case value::INT_T:
+				write_raw<value::int_t>(aValue.get_int());
+				break;
+			case value::UINT_T:
+				write_raw<value::uint_t>(aValue.get_uint());
+				break;
+			case value::STRING_T:
+				{
+					const value::string_ref tmp = aValue.get_string();
+					write_string(tmp.data(), tmp.size());
+				}
+				break;
+			case value::PACKED_ARRAY_T:
+				{
+					const value::packed_array_t& tmp = aValue.get_packed_array();
+					put(static_cast<char>(tmp.get_element_type()));
+					write_varint(tmp.size());
+					write(tmp.data(), tmp.size_in_bytes());
+				}
+				break;
+			case value::ARRAY_T:
+				{
+					const value::array_t& tmp = aValue.get_array();
+					write_varint(tmp.size());
+					if(mIndexed) {
+						++mNextLayout;
+						write_array_table(tmp);
+					}
+					for(const value& i : tmp) write_value(i);
+				}
+				break;
+			case value::OBJECT_T:
+				{
+					const value::object_t& tmp = aValue.get_object();
+					write_varint(tmp.size());
+					if(mIndexed) {
+						++mNextLayout;
+						write_object_table(tmp);
+					}
+					for(const auto& i : tmp) {
+						write_key(i.first);
+						write_value(i.second);
+					}
+				}
+				break;
+			default:
+				throw std::runtime_error("binary_format : Invalid serial type");
+				break;
+			}
+		}
+	};
+
+	//! \brief Reads a value tree through the stream buffer, without consuming anything after the document
+	class binary_reader {
+	private:
+		std::streambuf& mBuffer;
+		std::string mKey;
+		std::vector<value::key_t> mKeys;
+		uint8_t mVersion;
+		uint8_t mFlags;
+
+		uint8_t get() {
+			const std::streambuf::int_type c = mBuffer.sbumpc();
+			if(c == std::streambuf::traits_type::eof()) throw std::runtime_error("binary_format : Unexpected end of stream");
+			return static_cast<uint8_t>(c);
+		}
+
+		void read(void* aData, const size_t aSize) {
+			if(static_cast<size_t>(mBuffer.sgetn(static_cast<char*>(aData), static_cast<std::streamsize>(aSize))) != aSize) {
+				throw std::runtime_error("binary_format : Unexpected end of stream");
+			}
+		}
+
+		template<class T>
+		T read_raw() {
+			T tmp;
+			read(&tmp, sizeof(T));
+			return tmp;
+		}
+
+		value::bool_t read_bool() {
+			const uint8_t c = get();
+			if(c > 1) throw std::runtime_error("binary_format : Invalid bool");
+			return c != 0;
+		}
+
+		uint64_t read_varint() {
+			uint64_t tmp = 0;
+			for(size_t shift = 0; shift < 64; shift += 7) {
+				const uint8_t c = get();
+				tmp |= static_cast<uint64_t>(c & 0x7F) << shift;
+				if((c & 0x80) == 0) return tmp;
+			}
+			throw std::runtime_error("binary_format : Length is too long");
+		}
+
+		uint64_t read_size() {
+			return mVersion == 1 ? read_raw<uint16_t>() : read_varint();
+		}
+
+		void skip_table(uint64_t aCount) {
+			if((mFlags & BINARY_INDEXED) == 0) return;
+			char tmp[BINARY_OFFSET_SIZE * 512];
+			while(aCount > 0) {
+				const size_t count = static_cast<size_t>(std::min<uint64_t>(aCount, 512));
+				read(tmp, count * BINARY_OFFSET_SIZE);
+				aCount -= count;
+			}
+		}
+
+		template<class STRING>
+		void read_string(STRING& aString) {
+			read_string(aString, read_size());
+		}
+
+		template<class STRING>
+		void read_string(STRING& aString, uint64_t size) {
+			aString.clear();
+			// Grow in blocks so that a corrupt length fails at the end of the stream instead of allocating it all
+			while(size > 0) {
+				const size_t offset = aString.size();
+				const size_t block = static_cast<size_t>(std::min<uint64_t>(size, BINARY_STRING_BLOCK));
+				aString.resize(offset + block);
+				read(&aString[offset], block);
+				size -= block;
+			}
+		}
+
+		value::key_t read_key() {
+			if(mFlags & BINARY_KEY_DICTIONARY) {
+				const uint64_t index = read_varint();
+				if(index >= mKeys.size()) throw std::runtime_error("binary_format : Key index is out of range");
+				return mKeys[static_cast<size_t>(index)];
+			}
+			read_string(mKey);
+			return value::key_t(mKey.data(), mKey.size());
+		}
+
+		void read_columns(value& aValue, const size_t aDepth) {
+			const uint64_t rows = read_varint();
+			if(get() != value::OBJECT_T) throw std::runtime_error("binary_format : Invalid column table");
+			const uint64_t count = read_varint();
+			if(count == 0) throw std::runtime_error("binary_format : Invalid column table");
+			skip_table(count);
+			value::array_t& tmp = aValue.set_array();
+			value column;
+			for(uint64_t i = 0; i < count; ++i) {
+				const value::key_t key = read_key();
+				read_value(column, aDepth + 1);
+				// The rows are only allocated once a column has shown that the row count is real
+				if(i == 0) {
+					if(column.size() != rows) throw std::runtime_error("binary_format : Column length does not match the number of rows");
+					tmp.resize(static_cast<size_t>(rows));
+					for(value& j : tmp) j.set_object();
+				}
+				binary_scatter_column(tmp, key, column);
+			}
+		}
+
+		void read_packed_array(value::packed_array_t& aArray) {
+			const uint8_t type = get();
+			if(type > value::packed_array_t::DOUBLE_T) throw std::runtime_error("binary_format : Invalid packed element type");
+			aArray.set_element_type(static_cast<value::packed_array_t::element_type>(type));
+			const size_t element = value::packed_array_t::element_size(aArray.get_element_type());
+			uint64_t size = read_varint();
+			// Read whole blocks of elements so that a corrupt length fails at the end of the stream
+			const size_t block = BINARY_STRING_BLOCK / element;
+			while(size > 0) {
+				const size_t offset = aArray.size();
+				const size_t count = static_cast<size_t>(std::min<uint64_t>(size, block));
+				aArray.resize(offset + count);
+				read(static_cast<char*>(aArray.data()) + offset * element, count * element);
+				size -= count;
+			}
+		}
+	public:
+		explicit binary_reader(std::streambuf& aBuffer) :
+			mBuffer(aBuffer),
+			mVersion(1),
+			mFlags(0)
+		{}
+
+		void read_header() {
+			const std::streambuf::int_type c = mBuffer.sgetc();
+			if(c == std::streambuf::traits_type::eof()) throw std::runtime_error("binary_format : Unexpected end of stream");
+			if(static_cast<uint8_t>(c) <= value::UINT_T) {
+				mVersion = 1;
+				return;
+			}
+
+			char magic[sizeof(BINARY_MAGIC)];
+			read(magic, sizeof(magic));
+			if(std::memcmp(magic, BINARY_MAGIC, sizeof(magic)) != 0) throw std::runtime_error("binary_format : Not a binary document");
+			mVersion = get();
+			if(mVersion < 2 || mVersion > binary_format::VERSION) throw std::runtime_error("binary_format : Unsupported version");
+			mFlags = get();
+			if((mFlags & ~BINARY_FLAGS) != 0) throw std::runtime_error("binary_format : Unsupported flags");
+
+			if(mFlags & BINARY_KEY_DICTIONARY) {
+				const uint64_t count = read_varint();
+				skip_table(count);
+				mKeys.clear();
+				mKeys.reserve(static_cast<size_t>(std::min<uint64_t>(count, BINARY_MAX_RESERVE)));
+				for(uint64_t i = 0; i < count; ++i) {
+					read_string(mKey);
+					mKeys.push_back(value::key_t(mKey.data(), mKey.size()));
+				}
+			}
+		}
+
+		void read_value(value& aValue, const size_t aDepth = 0) {
+			if(aDepth > BINARY_MAX_DEPTH) throw std::runtime_error("binary_format : Values are nested too deeply");
+			switch(get()) {
+			case value::NULL_T:
+				aValue.set_null();
+				break;
+			case value::BOOL_T:
+				aValue.set_bool() = read_bool();
+				break;
+			case value::CHAR_T:
+				aValue.set_char() = read_raw<value::char_t>();
+				break;
+			case value::NUMBER_T:
+				aValue.set_number() = read_raw<value::number_t>();
+				break;
+			case value::INT_T:
+				aValue.set_int() = read_raw<value::int_t>();
+				break;
+			case value::UINT_T:
+				aValue.set_uint() = read_raw<value::uint_t>();
+				break;
+			case value::STRING_T:
+				{
+					const uint64_t size = read_size();
+					if(size <= value::SHORT_STRING_CAPACITY) {
+						char tmp[value::SHORT_STRING_CAPACITY];
+						read(tmp, static_cast<size_t>(size));
+						aValue.set_string(tmp, static_cast<size_t>(size));
+					}else {
+						read_string(aValue.set_string(), size);
+					}
+				}
+				break;
+			case value::PACKED_ARRAY_T:
+				read_packed_array(aValue.set_packed_array());
+				break;
+			case value::ARRAY_T:
+				{
+					value::array_t& tmp = aValue.set_array();
+					const uint64_t size = read_size();
+					skip_table(size);
+					tmp.reserve(static_cast<size_t>(std::min<uint64_t>(size, BINARY_MAX_RESERVE)));
+					for(uint64_t i = 0; i < size; ++i) {
+						tmp.emplace_back();
+						read_value(tmp.back(), aDepth + 1);
+					}
+				}
+				break;
+			case value::OBJECT_T:
+				{
+					aValue.set_object();
+					const uint64_t size = read_size();
+					skip_table(size);
+					aValue.reserve(static_cast<size_t>(std::min<uint64_t>(size, BINARY_MAX_RESERVE)));
+					value::object_t& tmp = aValue.get_object();
+					for(uint64_t i = 0; i < size; ++i) {
+						read_value(tmp.emplace(read_key(), value()).first->second, aDepth + 1);
+					}
+				}
+				break;
+			case BINARY_COLUMNS:
+				read_columns(aValue, aDepth);
+				break;
+			default:
+				throw std::runtime_error("binary_format : Invalid serial type");
+				break;
+			}
+		}
+	};
+
+	// binary_format
+
+	binary_format::binary_format() :
+		mIndexed(false),
+		mKeyDictionary(false),
+		mColumnar(false)
+	{}
+
+	binary_format& binary_format::set_indexed(const bool aIndexed) {
+		mIndexed = aIndexed;
+		return *this;
+	}
+
+	binary_format& binary_format::set_key_dictionary(const bool aKeyDictionary) {
+		mKeyDictionary = aKeyDictionary;
+		return *this;
+	}
+
+	binary_format& binary_format::set_columnar(const bool aColumnar) {
+		mColumnar = aColumnar;
+		return *this;
+	}
+
+	void binary_format::write_serial(const value& aType, std::ostream& aStream) {
+		binary_writer writer(aStream, mIndexed, mKeyDictionary, mColumnar);
+		writer.write_header(aType);
+		writer.write_value(aType);
+		writer.flush();
+	}
+
+	value binary_format::read_serial(std::istream& aStream) {
+		std::streambuf* const buffer = aStream.rdbuf();
+		if(! buffer) throw std::runtime_error("binary_format : Stream has no buffer");
+		binary_reader reader(*buffer);
+		value tmp;
+		try {
+			reader.read_header();
+			reader.read_value(tmp);
+		}catch(...) {
+			aStream.setstate(std::ios::failbit);
+			throw;
+		}
+		return tmp;
+	}
+
+	// binary_document
+
+	//! \brief Read a LEB128 number from a document, advancing the offset past it
+	static uint64_t binary_read_varint(const char* aData, const size_t aSize, uint64_t& aOffset) {
+		uint64_t tmp = 0;
+		for(size_t shift = 0; shift < 64; shift += 7) {
+			if(aOffset >= aSize) throw std::runtime_error("binary_document : Offset is outside of the document");
+			const uint8_t c = static_cast<uint8_t>(aData[aOffset++]);
+			tmp |= static_cast<uint64_t>(c & 0x7F) << shift;
+			if((c & 0x80) == 0) return tmp;
+		}
+		throw std::runtime_error("binary_format : Length is too long");
+	}
+
+	static void binary_unmap(void* aMapping, const size_t aSize) throw() {
+#ifdef _WIN32
+		UnmapViewOfFile(aMapping);
+#else
+		munmap(aMapping, aSize);
+#endif
+	}
+
+	binary_document::binary_document(const char* aData, const size_t aSize) :
+		mData(aData),
+		mSize(aSize),
+		mMapping(nullptr),
+		mMappingSize(0),
+		mKeyCount(0),
+		mKeyTable(0),
+		mRoot(BINARY_HEADER_SIZE),
+		mKeyDictionary(false)
+	{
+		check();
+	}
+
+	binary_document::binary_document(const std::string& aPath) :
+		mData(nullptr),
+		mSize(0),
+		mMapping(nullptr),
+		mMappingSize(0),
+		mKeyCount(0),
+		mKeyTable(0),
+		mRoot(BINARY_HEADER_SIZE),
+		mKeyDictionary(false)
+	{
+#ifdef _WIN32
+		const HANDLE file = CreateFileA(aPath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if(file == INVALID_HANDLE_VALUE) throw std::runtime_error("binary_document : Could not open file");
+		LARGE_INTEGER size;
+		if(! GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+			CloseHandle(file);
+			throw std::runtime_error("binary_document : Could not map file");
+		}
+		const HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		CloseHandle(file);
+		if(! mapping) throw std::runtime_error("binary_document : Could not map file");
+		mMapping = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		CloseHandle(mapping);
+		if(! mMapping) throw std::runtime_error("binary_document : Could not map file");
+		mMappingSize = static_cast<size_t>(size.QuadPart);
+#else
+		const int file = open(aPath.c_str(), O_RDONLY);
+		if(file == -1) throw std::runtime_error("binary_document : Could not open file");
+		struct stat info;
+		if(fstat(file, &info) != 0 || info.st_size == 0) {
+			close(file);
+			throw std::runtime_error("binary_document : Could not map file");
+		}
+		void* const mapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, file, 0);
+		close(file);
+		if(mapping == MAP_FAILED) throw std::runtime_error("binary_document : Could not map file");
+		mMapping = mapping;
+		mMappingSize = static_cast<size_t>(info.st_size);
+#endif
+		mData = static_cast<const char*>(mMapping);
+		mSize = mMappingSize;
+		try {
+			check();
+		}catch(...) {
+			binary_unmap(mMapping, mMappingSize);
+			throw;
+		}
+	}
+
+	binary_document::~binary_document() throw() {
+		if(mMapping) binary_unmap(mMapping, mMappingSize);
+	}
+
+	void binary_document::check() {
+		const char* const header = at(0, BINARY_HEADER_SIZE);
+		if(std::memcmp(header, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0) throw std::runtime_error("binary_format : Not a binary document");
+		const uint8_t version = static_cast<uint8_t>(header[sizeof(BINARY_MAGIC)]);
+		if(version < 2 || version > binary_format::VERSION) throw std::runtime_error("binary_format : Unsupported version");
+		const uint8_t flags = static_cast<uint8_t>(header[sizeof(BINARY_MAGIC) + 1]);
+		if((flags & ~BINARY_FLAGS) != 0) throw std::runtime_error("binary_format : Unsupported flags");
+		if((flags & BINARY_INDEXED) == 0) throw std::runtime_error("binary_document : Document was not written with offset tables");
+
+		mRoot = BINARY_HEADER_SIZE;
+		mKeyDictionary = (flags & BINARY_KEY_DICTIONARY) != 0;
+		if(mKeyDictionary) {
+			mKeyCount = binary_read_varint(mData, mSize, mRoot);
+			if(mKeyCount > mSize / BINARY_OFFSET_SIZE) throw std::runtime_error("binary_document : Offset is outside of the document");
+			mKeyTable = mRoot;
+			mRoot += mKeyCount * BINARY_OFFSET_SIZE;
+			if(mKeyCount > 0) {
+				// The root follows the last name
+				uint64_t last;
+				std::memcpy(&last, at(mKeyTable + (mKeyCount - 1) * BINARY_OFFSET_SIZE, BINARY_OFFSET_SIZE), BINARY_OFFSET_SIZE);
+				const binary_string name = string(last);
+				mRoot = static_cast<uint64_t>(name.data + name.size - mData);
+			}
+		}
+		at(mRoot, 1);
+	}
+
+	const char* binary_document::at(const uint64_t aOffset, const size_t aSize) const {
+		if(aOffset > mSize || mSize - aOffset < aSize) throw std::runtime_error("binary_document : Offset is outside of the document");
+		return mData + aOffset;
+	}
+
+	binary_string binary_document::string(uint64_t& aOffset) const {
+		const uint64_t size = binary_read_varint(mData, mSize, aOffset);
+		if(size > mSize) throw std::runtime_error("binary_document : Offset is outside of the document");
+		binary_string tmp;
+		tmp.data = at(aOffset, static_cast<size_t>(size));
+		tmp.size = static_cast<size_t>(size);
+		aOffset += size;
+		return tmp;
+	}
+
+	binary_string binary_document::key(uint64_t& aOffset) const {
+		if(! mKeyDictionary) return string(aOffset);
+		const uint64_t index = binary_read_varint(mData, mSize, aOffset);
+		if(index >= mKeyCount) throw std::runtime_error("binary_format : Key index is out of range");
+		uint64_t offset;
+		std::memcpy(&offset, at(mKeyTable + index * BINARY_OFFSET_SIZE, BINARY_OFFSET_SIZE), BINARY_OFFSET_SIZE);
+		return string(offset);
+	}
+
+	binary_node binary_document::root() const {
+		return binary_node(this, mRoot);
+	}
+
+	// binary_node
+
+	binary_node::binary_node(const binary_document* aDocument, const uint64_t aOffset) throw() :
+		mDocument(aDocument),
+		mOffset(aOffset)
+	{}
+
+	value::type binary_node::get_type() const {
+		const uint8_t type = static_cast<uint8_t>(*mDocument->at(mOffset, 1));
+		if(type == BINARY_COLUMNS) return value::ARRAY_T;
+		if(type > value::PACKED_ARRAY_T) throw std::runtime_error("binary_format : Invalid serial type");
+		return static_cast<value::type>(type);
+	}
+
+	bool binary_node::is_columnar() const {
+		return static_cast<uint8_t>(*mDocument->at(mOffset, 1)) == BINARY_COLUMNS;
+	}
+
+	binary_node binary_node::columns() const {
+		if(! is_columnar()) throw std::runtime_error("binary_document : Array was not written as columns");
+		uint64_t offset = mOffset + 1;
+		binary_read_varint(mDocument->mData, mDocument->mSize, offset);
+		const binary_node tmp(mDocument, offset);
+		if(tmp.get_type() != value::OBJECT_T) throw std::runtime_error("binary_format : Invalid column table");
+		return tmp;
+	}
+
+	size_t binary_node::size() const {
+		const value::type type = get_type();
+		if(type == value::PACKED_ARRAY_T) {
+			value::packed_array_t::element_type element;
+			size_t count;
+			get_packed_array(element, count);
+			return count;
+		}
+		if(type != value::ARRAY_T && type != value::OBJECT_T) return 0;
+		uint64_t offset = mOffset + 1;
+		return static_cast<size_t>(binary_read_varint(mDocument->mData, mDocument->mSize, offset));
+	}
+
+	uint64_t binary_node::element(const size_t aIndex) const {
+		uint64_t offset = mOffset + 1;
+		const uint64_t count = binary_read_varint(mDocument->mData, mDocument->mSize, offset);
+		if(aIndex >= count) throw std::runtime_error("binary_document : Index is out of bounds");
+		if(count > mDocument->mSize / BINARY_OFFSET_SIZE) throw std::runtime_error("binary_document : Offset is outside of the document");
+		uint64_t tmp;
+		std::memcpy(&tmp, mDocument->at(offset + aIndex * BINARY_OFFSET_SIZE, BINARY_OFFSET_SIZE), BINARY_OFFSET_SIZE);
+		// Elements are written after the table, so an offset that points anywhere else could form a cycle
+		if(tmp < offset + count * BINARY_OFFSET_SIZE || tmp >= mDocument->mSize) {
+			throw std::runtime_error("binary_document : Offset is outside of the document");
+		}
+		return tmp;
+	}
+
+	binary_node binary_node::operator[](const size_t aIndex) const {
+		switch(get_type()) {
+		case value::ARRAY_T:
+			if(is_columnar()) throw std::runtime_error("binary_document : Rows of a columnar array are read with columns() or materialise()");
+			return binary_node(mDocument, element(aIndex));
 		case value::OBJECT_T:
 			{
-				const value::object_t tmp = aType.get_object();
-				const uint16_t buf = static_cast<uint16_t>(tmp.size());
-				aStream.write(reinterpret_cast<const char*>(&buf), sizeof(buf));
-				for(const auto& i : tmp) {
-					const uint16_t buf2 = static_cast<uint16_t>(i.first.size());
-					aStream.write(reinterpret_cast<const char*>(&buf2), sizeof(buf2));
-					aStream.write(i.first.c_str(), buf2);
-					write_serial(i.second, aStream);
-				}
+				uint64_t offset = element(aIndex);
+				mDocument->key(offset);
+				return binary_node(mDocument, offset);
 			}
-			break;
 		default:
-			throw std::runtime_error("binary_format : Invalid serial type");
-			break;
+			throw std::runtime_error("binary_document : Value is not an array or object");
 		}
 	}
-	
-	value binary_format::read_serial(std::istream& aStream) {
-		value value;
-		value::type tBuf;
-		aStream.read(reinterpret_cast<char*>(&tBuf), sizeof(tBuf));
-	
-		switch(tBuf) {
+
+	binary_node binary_node::operator[](const std::string& aName) const {
+		binary_node tmp(mDocument, 0);
+		if(! find(aName.data(), aName.size(), tmp)) throw std::runtime_error("binary_document : Object does not contain object with given name");
+		return tmp;
+	}
+
+	bool binary_node::find(const char* aName, const size_t aSize, binary_node& aNode) const {
+		if(get_type() != value::OBJECT_T) throw std::runtime_error("binary_document : Value is not an object");
+		size_t begin = 0;
+		size_t end = size();
+		while(begin < end) {
+			const size_t middle = begin + (end - begin) / 2;
+			uint64_t offset = element(middle);
+			const binary_string name = mDocument->key(offset);
+			int cmp = std::memcmp(name.data, aName, std::min(name.size, aSize));
+			if(cmp == 0) cmp = name.size < aSize ? -1 : name.size > aSize ? 1 : 0;
+			if(cmp == 0) {
+				aNode = binary_node(mDocument, offset);
+				return true;
+			}
+			if(cmp < 0) begin = middle + 1;
+			else end = middle;
+		}
+		return false;
+	}
+
+	binary_string binary_node::key(const size_t aIndex) const {
+		if(get_type() != value::OBJECT_T) throw std::runtime_error("binary_document : Value is not an object");
+		uint64_t offset = element(aIndex);
+		return mDocument->key(offset);
+	}
+
+	value binary_node::scalar() const {
+		const value::type type = get_type();
+		switch(type) {
 		case value::NULL_T:
-			value.set_null();
-			break;
+			return value();
 		case value::BOOL_T:
 			{
-				value::bool_t buf;
-				aStream.read(reinterpret_cast<char*>(&buf), sizeof(buf));
-				value.set_bool() = buf;
+				const uint8_t tmp = static_cast<uint8_t>(*mDocument->at(mOffset + 1, 1));
+				if(tmp > 1) throw std::runtime_error("binary_format : Invalid bool");
+				return value(tmp != 0);
 			}
-			break;
 		case value::CHAR_T:
+			return value(static_cast<value::char_t>(*mDocument->at(mOffset + 1, sizeof(value::char_t))));
+		case value::NUMBER_T:
 			{
-				value::char_t buf;
-				aStream.read(reinterpret_cast<char*>(&buf), sizeof(buf));
-				value.set_char() = buf;
+				value::number_t tmp;
+				std::memcpy(&tmp, mDocument->at(mOffset + 1, sizeof(tmp)), sizeof(tmp));
+				return value(tmp);
 			}
-			break;
-		case value::NUMBER_T:
+		case value::INT_T:
 			{
-				value::number_t buf;
-				aStream.read(reinterpret_cast<char*>(&buf), sizeof(buf));
-				value.set_number() = buf;
+				value::int_t tmp;
+				std::memcpy(&tmp, mDocument->at(mOffset + 1, sizeof(tmp)), sizeof(tmp));
+				return value(tmp);
 			}
-			break;
+		case value::UINT_T:
+			{
+				value::uint_t tmp;
+				std::memcpy(&tmp, mDocument->at(mOffset + 1, sizeof(tmp)), sizeof(tmp));
+				return value(tmp);
+			}
+		default:
+			return materialise();
+		}
+	}
+
+	value::bool_t binary_node::get_bool() const {
+		return scalar().get_bool();
+	}
+
+	value::char_t binary_node::get_char() const {
+		return scalar().get_char();
+	}
+
+	value::number_t binary_node::get_number() const {
+		return scalar().get_number();
+	}
+
+	value::int_t binary_node::get_int() const {
+		return scalar().get_int();
+	}
+
+	value::uint_t binary_node::get_uint() const {
+		return scalar().get_uint();
+	}
+
+	binary_string binary_node::get_string() const {
+		if(get_type() != value::STRING_T) throw std::runtime_error("binary_document : Value is not a string");
+		uint64_t offset = mOffset + 1;
+		return mDocument->string(offset);
+	}
+
+	const char* binary_node::get_packed_array(value::packed_array_t::element_type& aType, size_t& aSize) const {
+		if(get_type() != value::PACKED_ARRAY_T) throw std::runtime_error("binary_document : Value is not a packed array");
+		const uint8_t type = static_cast<uint8_t>(*mDocument->at(mOffset + 1, 1));
+		if(type > value::packed_array_t::DOUBLE_T) throw std::runtime_error("binary_format : Invalid packed element type");
+		aType = static_cast<value::packed_array_t::element_type>(type);
+		uint64_t offset = mOffset + 2;
+		const uint64_t size = binary_read_varint(mDocument->mData, mDocument->mSize, offset);
+		const size_t element = value::packed_array_t::element_size(aType);
+		if(size > mDocument->mSize / element) throw std::runtime_error("binary_document : Offset is outside of the document");
+		aSize = static_cast<size_t>(size);
+		return mDocument->at(offset, aSize * element);
+	}
+
+	std::vector<uint64_t> binary_node::sorted_elements() const {
+		const size_t s = size();
+		std::vector<uint64_t> tmp;
+		tmp.reserve(std::min<size_t>(s, BINARY_MAX_RESERVE));
+		for(size_t i = 0; i < s; ++i) tmp.push_back(element(i));
+		std::sort(tmp.begin(), tmp.end());
+		if(std::adjacent_find(tmp.begin(), tmp.end()) != tmp.end()) throw std::runtime_error("binary_document : Elements overlap");
+		return tmp;
+	}
+
+	//! \brief Check that a child ends before the next child begins
+	//! \detail Children that overlap could be shared by several tables, which would make materialising a small
+	//! document exponentially expensive.
+	static void binary_check_child(const std::vector<uint64_t>& aOffsets, const uint64_t aOffset, const uint64_t aEnd) {
+		const auto next = std::upper_bound(aOffsets.begin(), aOffsets.end(), aOffset);
+		if(next != aOffsets.end() && aEnd > *next) throw std::runtime_error("binary_document : Elements overlap");
+	}
+
+	value binary_node::materialise() const {
+		uint64_t end;
+		return build(0, end);
+	}
+
+	value binary_node::materialise(const std::vector<std::string>& aNames) const {
+		return build(aNames, 0);
+	}
+
+	value binary_node::build(const size_t aDepth, uint64_t& aEnd) const {
+		if(aDepth > BINARY_MAX_DEPTH) throw std::runtime_error("binary_format : Values are nested too deeply");
+		value tmp;
+		switch(get_type()) {
 		case value::STRING_T:
 			{
-				value::string_t& tmp = value.set_string();
-				uint16_t buf;
-				aStream.read(reinterpret_cast<char*>(&buf), sizeof(buf));
-				char c;
-				for(size_t i = 0; i < buf; ++i) {
-					aStream.read(&c, 1);
-					tmp += c;
-				}
+				const binary_string str = get_string();
+				tmp.set_string(str.data, str.size);
 			}
 			break;
-		case value::ARRAY_T:
+		case value::PACKED_ARRAY_T:
 			{
-				value::array_t& tmp = value.set_array();
-				uint16_t buf;
-				aStream.read(reinterpret_cast<char*>(&buf), sizeof(buf));
-				for(uint16_t i = 0; i < buf; ++i) tmp.push_back(read_serial(aStream));
+				value::packed_array_t::element_type type;
+				size_t count;
+				const char* const data = get_packed_array(type, count);
+				tmp.set_packed_array().assign(type, data, count);
 			}
 			break;
+		case value::ARRAY_T:
+			if(is_columnar()) {
+				// Every row has at least a byte in each column
+				const size_t s = size();
+				if(s > mDocument->mSize) throw std::runtime_error("binary_document : Offset is outside of the document");
+				const binary_node columns_ = columns();
+				if(columns_.size() == 0) throw std::runtime_error("binary_format : Invalid column table");
+				value table = columns_.build(aDepth + 1, aEnd);
+				value::array_t& rows = tmp.set_array();
+				rows.resize(s);
+				for(value& i : rows) i.set_object();
+				for(auto& i : table.get_object()) binary_scatter_column(rows, i.first, i.second);
+				return tmp;
+			}else {
+				const std::vector<uint64_t> offsets = sorted_elements();
+				value::array_t& array_ = tmp.set_array();
+				array_.reserve(offsets.size());
+				aEnd = mOffset + 1;
+				aEnd += binary_varint_size(offsets.size()) + offsets.size() * BINARY_OFFSET_SIZE;
+				const size_t s = offsets.size();
+				for(size_t i = 0; i < s; ++i) {
+					const uint64_t offset = element(i);
+					uint64_t end;
+					array_.push_back(binary_node(mDocument, offset).build(aDepth + 1, end));
+					binary_check_child(offsets, offset, end);
+					aEnd = std::max(aEnd, end);
+				}
+			}
+			return tmp;
 		case value::OBJECT_T:
 			{
-				value::object_t& tmp = value.set_object();
-				uint16_t buf ;
-				aStream.read(reinterpret_cast<char*>(&buf), sizeof(buf));
-				for(uint16_t i = 0; i < buf; ++i) {
-					std::string key;
-					uint16_t kSize; 
-					aStream.read(reinterpret_cast<char*>(&kSize), sizeof(kSize));
-					char c;
-					for(uint16_t j = 0; j < kSize; ++j) {
-						aStream.read(&c, 1);
-						key += c;
-					}
-					tmp.emplace(key, read_serial(aStream));
+				const std::vector<uint64_t> offsets = sorted_elements();
+				tmp.set_object();
+				tmp.reserve(offsets.size());
+				value::object_t& object = tmp.get_object();
+				aEnd = mOffset + 1;
+				aEnd += binary_varint_size(offsets.size()) + offsets.size() * BINARY_OFFSET_SIZE;
+				const size_t s = offsets.size();
+				for(size_t i = 0; i < s; ++i) {
+					const uint64_t offset = element(i);
+					uint64_t member = offset;
+					const binary_string name = mDocument->key(member);
+					uint64_t end;
+					object.emplace(value::key_t(name.data, name.size), binary_node(mDocument, member).build(aDepth + 1, end));
+					binary_check_child(offsets, offset, end);
+					aEnd = std::max(aEnd, end);
 				}
 			}
-			break;
+			return tmp;
 		default:
-			throw std::runtime_error("binary_format : Invalid serial type");
+			tmp = scalar();
 			break;
 		}
-		return value;
+		aEnd = mOffset + binary_scalar_size(tmp);
+		return tmp;
+	}
+
+	value binary_node::build(const std::vector<std::string>& aNames, const size_t aDepth) const {
+		if(aDepth > BINARY_MAX_DEPTH) throw std::runtime_error("binary_format : Values are nested too deeply");
+		if(get_type() != value::ARRAY_T) throw std::runtime_error("binary_document : Value is not an array");
+		value tmp;
+		value::array_t& rows = tmp.set_array();
+		const size_t s = size();
+		binary_node member(mDocument, 0);
+
+		if(is_columnar()) {
+			// Every row has at least a byte in each column
+			if(s > mDocument->mSize) throw std::runtime_error("binary_document : Offset is outside of the document");
+			const binary_node columns_ = columns();
+			rows.resize(s);
+			for(value& i : rows) i.set_object();
+			for(const std::string& i : aNames) {
+				if(! columns_.find(i.data(), i.size(), member)) continue;
+				uint64_t end;
+				value column = member.build(aDepth + 2, end);
+				binary_scatter_column(rows, value::key_t(i), column);
+			}
+		}else {
+			const std::vector<uint64_t> offsets = sorted_elements();
+			rows.reserve(offsets.size());
+			for(size_t i = 0; i < s; ++i) {
+				const binary_node row = operator[](i);
+				rows.push_back(value(value::OBJECT_T));
+				value::object_t& object = rows.back().get_object();
+				for(const std::string& j : aNames) {
+					if(! row.find(j.data(), j.size(), member)) continue;
+					uint64_t end;
+					object.emplace(value::key_t(j), member.build(aDepth + 2, end));
+					binary_check_child(offsets, row.mOffset, end);
+				}
+			}
+		}
+		return tmp;
 	}
-}}
\ No newline at end of file
+}}
@@ -13,6 +13,7 @@
 
 #include "asmith/serial/ini.hpp"
 #include <sstream>
+#include "asmith/serial/number.hpp"
 #include "asmith/serial/string_tools.hpp"
 	
 namespace asmith { namespace serial {
@@ -28,26 +29,35 @@ namespace asmith { namespace serial {
 			aStream << aName << mNameSeperator << (aValue.get_bool() ? "true" : "false") << std::endl;
 			break;
 		case value::NUMBER_T:
-			aStream << aName << mNameSeperator << aValue.get_number() << std::endl;
+			aStream << aName << mNameSeperator;
+			write_number(aStream, aValue.get_number()) << std::endl;
+			break;
+		case value::INT_T:
+			aStream << aName << mNameSeperator << aValue.get_int() << std::endl;
+			break;
+		case value::UINT_T:
+			aStream << aName << mNameSeperator << aValue.get_uint() << std::endl;
 			break;
 		case value::STRING_T:
 			aStream << aName << mNameSeperator << aValue.get_string() << std::endl;
 			break;
 		case value::ARRAY_T:
+		case value::PACKED_ARRAY_T:
 			{
-				const value::array_t& array_ = aValue.get_array();
+				value::array_t buf;
+				const value::array_t& array_ = aValue.get_type() == value::ARRAY_T ? aValue.get_array() : (buf = aValue.as_array());
 				const std::string parentName = aParentName == "" ? aName : aParentName + mHierarchySeperator + aName;
 				if(parentName != "") aStream << '[' << parentName << ']' << std::endl;
 				size_t j = 0;
 				for(const auto& i : array_) {
 					const value::type t = i.get_type();
-					if(t != value::ARRAY_T && t != value::OBJECT_T) write_ini(parentName, std::to_string(j), i, aStream);
+					if(t != value::ARRAY_T && t != value::PACKED_ARRAY_T && t != value::OBJECT_T) write_ini(parentName, std::to_string(j), i, aStream);
 					++j;
 				}
 				j = 0;
 				for(const auto& i : array_) {
 					const value::type t = i.get_type();
-					if(t == value::ARRAY_T || t == value::OBJECT_T) write_ini(parentName, std::to_string(j), i, aStream);
+					if(t == value::ARRAY_T || t == value::PACKED_ARRAY_T || t == value::OBJECT_T) write_ini(parentName, std::to_string(j), i, aStream);
 					++j;
 				}
 			}
@@ -59,11 +69,11 @@ namespace asmith { namespace serial {
 				if(parentName != "") aStream << '[' << parentName << ']' << std::endl;
 				for(const auto& i : object) {
 					const value::type t = i.second.get_type();
-					if(t != value::ARRAY_T && t != value::OBJECT_T) write_ini(parentName, i.first, i.second, aStream);
+					if(t != value::ARRAY_T && t != value::PACKED_ARRAY_T && t != value::OBJECT_T) write_ini(parentName, std::string(i.first.c_str(), i.first.size()), i.second, aStream);
 				}
 				for(const auto& i : object) {
 					const value::type t = i.second.get_type();
-					if(t == value::ARRAY_T || t == value::OBJECT_T) write_ini(parentName, i.first, i.second, aStream);
+					if(t == value::ARRAY_T || t == value::PACKED_ARRAY_T || t == value::OBJECT_T) write_ini(parentName, std::string(i.first.c_str(), i.first.size()), i.second, aStream);
 				}
 			}
 			break;
@@ -119,15 +129,15 @@ namespace asmith { namespace serial {
 					if(head->get_type() != value::OBJECT_T) head->set_object();
 					value::object_t& object = head->get_object();
 					aKey.erase(aKey.begin());
-					object.emplace(aKey, value(aValue));
+					object.emplace(value::string_t(aKey.c_str(), aKey.size()), value(aValue));
 					break;
 				}else if (j == std::string::npos) {
 					if(head->get_type() != value::OBJECT_T) head->set_object();
 					value::object_t& object = head->get_object();
-					object.emplace(aKey, value(aValue));
+					object.emplace(value::string_t(aKey.c_str(), aKey.size()), value(aValue));
 					break;
 				}else {
-					const std::string next = aKey.substr(0, j);
+					const value::string_t next(aKey.c_str(), j);
 					value::object_t& object = head->get_object();
 					auto k = object.find(next);
 					if(k == object.end()) {
@@ -0,0 +1,58 @@
+//	Copyright 2017 Adam Smith
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+
+#include "asmith/serial/intern.hpp"
+
+namespace asmith { namespace serial {
+
+	// value_intern_table
+
+	value value_intern_table::intern(value aValue) {
+		// Children are interned first so that comparing candidates stops at shared subtrees
+		switch(aValue.get_type()) {
+		case value::STRING_T:
+		case value::PACKED_ARRAY_T:
+			break;
+		case value::ARRAY_T:
+			for(value& i : aValue.get_array()) i = intern(std::move(i));
+			break;
+		case value::OBJECT_T:
+			for(auto& i : aValue.get_object()) i.second = intern(std::move(i.second));
+			break;
+		default:
+			return aValue;
+		}
+
+		aValue.share();
+		if(! aValue.is_shared()) return aValue;
+
+		const size_t hash = aValue.hash();
+		std::lock_guard<std::mutex> lock(mLock);
+		const auto range = mValues.equal_range(hash);
+		for(auto i = range.first; i != range.second; ++i) {
+			if(i->second == aValue) return i->second;
+		}
+		mValues.emplace(hash, aValue);
+		return aValue;
+	}
+
+	size_t value_intern_table::size() const {
+		std::lock_guard<std::mutex> lock(mLock);
+		return mValues.size();
+	}
+
+	void value_intern_table::clear() {
+		std::lock_guard<std::mutex> lock(mLock);
+		mValues.clear();
+	}
+}}
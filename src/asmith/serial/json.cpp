@@ -12,32 +12,1011 @@
 //	limitations under the License.
 
 #include "asmith/serial/json.hpp"
-#include "asmith/serial/string_tools.hpp"
+#include "asmith/serial/json_index.hpp"
+#include "asmith/serial/json_string.hpp"
+#include "asmith/serial/number.hpp"
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <istream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 	
 namespace asmith { namespace serial {
 
-	value::type json_determine_type(std::istream& aStream) {
-		skip_whitespace(aStream);
-		char c = aStream.peek();
-		switch(c) {
+	enum : size_t {
+		JSON_MAX_DEPTH = 512 //!< Arrays and objects nested deeper than this are rejected before they can exhaust the stack
+	};
+
+	// json_reader
+
+	static bool json_is_delimiter(const char aChar) throw() {
+		switch(aChar) {
+		case ' ':
+		case '\t':
+		case '\n':
+		case '\r':
+		case ',':
+		case ':':
+		case '[':
+		case ']':
+		case '{':
+		case '}':
+		case '"':
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	//! \return The closing quote of a string whose contents start at aBegin
+	static const char* json_string_end(const char* aBegin, const char* aEnd) {
+		// Skip quotes preceded by an odd number of backslashes
+		const char* end = aBegin;
+		while(true) {
+			end = static_cast<const char*>(std::memchr(end, '"', aEnd - end));
+			if(! end) throw std::runtime_error("asmith::json_format::read_serial : Expected string to end with '\"'");
+			const char* i = end;
+			while(i != aBegin && i[-1] == '\\') --i;
+			if(((end - i) & 1) == 0) return end;
+			++end;
+		}
+	}
+
+	//! \brief Second stage of the JSON reader, walks a json_structural_index and reports each token to a handler
+	//! \detail HANDLER is either json_parser or a concrete builder, so building values does not pay for virtual calls
+	template<class HANDLER>
+	class json_reader {
+	private:
+		HANDLER& mHandler;
+		const char* const mBegin;
+		const char* const mEnd;
+		const uint32_t* mToken;
+		const uint32_t* const mTokenEnd;
+		const char* mPosition; //!< End of the last token that was consumed
+		std::string mScratch; //!< Decoded text of the last string that contained escapes
+
+		char peek() const throw() {
+			return mToken == mTokenEnd ? '\0' : mBegin[*mToken];
+		}
+
+		void expect(const char* aToken, const char* aLiteral, const size_t aSize, const char* aMessage) {
+			if(
+				static_cast<size_t>(mEnd - aToken) < aSize ||
+				std::memcmp(aToken, aLiteral, aSize) != 0 ||
+				(aToken + aSize != mEnd && ! json_is_delimiter(aToken[aSize]))
+			) throw std::runtime_error(aMessage);
+			mPosition = aToken + aSize;
+		}
+
+		void read_string_span(const char* aToken, const char*& aBegin, size_t& aSize) {
+			if(*aToken != '"') throw std::runtime_error("asmith::json_format::read_serial : Expected string to begin with '\"'");
+			aBegin = aToken + 1;
+
+			const char* const end = json_string_end(aBegin, mEnd);
+
+			aSize = end - aBegin;
+			mPosition = end + 1;
+		}
+
+		void read_string(const char* aToken, const char*& aBegin, size_t& aSize) {
+			read_string_span(aToken, aBegin, aSize);
+			if(json_unescape(aBegin, aSize, mScratch)) {
+				aBegin = mScratch.data();
+				aSize = mScratch.size();
+			}
+		}
+
+		void read_number(const char* aToken) {
+			parsed_number number;
+			const char* const end = parse_number(aToken, mEnd, number);
+			if(! end || (end != mEnd && ! json_is_delimiter(*end))) {
+				throw std::runtime_error("asmith::json_format::read_serial : Expected number");
+			}
+			mPosition = end;
+
+			switch(number.type) {
+			case value::INT_T:
+				mHandler.integer(number.int_value);
+				break;
+			case value::UINT_T:
+				mHandler.unsigned_integer(number.uint_value);
+				break;
+			default:
+				mHandler.number(number.number_value);
+				break;
+			}
+		}
+
+		void read_array(const size_t aDepth) {
+			mHandler.start_array();
+			while(peek() != ']') {
+				if(mToken == mTokenEnd) throw std::runtime_error("asmith::json_format::read_serial : Expected array to end with ']'");
+				read_value(aDepth);
+				const char c = peek();
+				if(c == ']') break;
+				else if(c != ',') throw std::runtime_error(mToken == mTokenEnd ?
+					"asmith::json_format::read_serial : Expected array to end with ']'" :
+					"asmith::json_format::read_serial : Expected array elements to be seperated with ','"
+				);
+				++mToken;
+			}
+			mPosition = mBegin + *mToken++ + 1;
+			mHandler.end_array();
+		}
+
+		void read_object(const size_t aDepth) {
+			mHandler.start_object();
+			while(peek() != '}') {
+				if(mToken == mTokenEnd) throw std::runtime_error("asmith::json_format::read_serial : Expected object to end with '}'");
+				const char* name;
+				size_t size;
+				read_string(mBegin + *mToken++, name, size);
+				if(peek() != ':') throw std::runtime_error("asmith::json_format::read_serial : Expected object name to be end with ':'");
+				++mToken;
+				mHandler.key(name, size);
+				read_value(aDepth);
+				const char c = peek();
+				if(c == '}') break;
+				else if(c != ',') throw std::runtime_error(mToken == mTokenEnd ?
+					"asmith::json_format::read_serial : Expected object to end with '}'" :
+					"asmith::json_format::read_serial : Expected object elements to be seperated with ','"
+				);
+				++mToken;
+			}
+			mPosition = mBegin + *mToken++ + 1;
+			mHandler.end_object();
+		}
+	public:
+		json_reader(HANDLER& aHandler, const char* aBegin, const char* aEnd, const uint32_t* aToken, const uint32_t* aTokenEnd) throw() :
+			mHandler(aHandler),
+			mBegin(aBegin),
+			mEnd(aEnd),
+			mToken(aToken),
+			mTokenEnd(aTokenEnd),
+			mPosition(aBegin)
+		{}
+
+		const char* position() const throw() {
+			return mPosition;
+		}
+
+		bool at_end() const throw() {
+			return mToken == mTokenEnd;
+		}
+
+		//! \brief The start of the next unread token, only valid when not at_end()
+		const char* next_token() const throw() {
+			return mBegin + *mToken;
+		}
+
+		//! \param aDepth The number of arrays and objects that contain the value
+		void read_value(const size_t aDepth = 0) {
+			if(mToken == mTokenEnd) throw std::runtime_error("asmith::json_format::read_serial : Could not determin JSON type");
+			const char* const token = mBegin + *mToken++;
+			switch(*token) {
+			case 'n':
+				expect(token, "null", 4, "asmith::json_format::read_serial : Expected 'null'");
+				mHandler.null();
+				break;
+			case 't':
+				expect(token, "true", 4, "asmith::json_format::read_serial : Expected 'true' or 'false'");
+				mHandler.boolean(true);
+				break;
+			case 'f':
+				expect(token, "false", 5, "asmith::json_format::read_serial : Expected 'true' or 'false'");
+				mHandler.boolean(false);
+				break;
+			case '0':
+			case '1':
+			case '2':
+			case '3':
+			case '4':
+			case '5':
+			case '6':
+			case '7':
+			case '8':
+			case '9':
+			case '-':
+			case '+':
+				read_number(token);
+				break;
+			case '"':
+				{
+					const char* str;
+					size_t size;
+					read_string(token, str, size);
+					mHandler.string(str, size);
+				}
+				break;
+			case '[':
+				if(aDepth >= JSON_MAX_DEPTH) throw std::runtime_error("asmith::json_format::read_serial : Values are nested too deeply");
+				read_array(aDepth + 1);
+				break;
+			case '{':
+				if(aDepth >= JSON_MAX_DEPTH) throw std::runtime_error("asmith::json_format::read_serial : Values are nested too deeply");
+				read_object(aDepth + 1);
+				break;
+			default:
+				throw std::runtime_error("asmith::json_format::read_serial : Could not determin JSON type");
+			}
+		}
+	};
+
+	//! \brief Builds a value tree from reader events
+	class json_value_builder {
+	private:
+		std::vector<value*> mStack;
+		value::key_t mKey;
+
+		value& add(value&& aValue) {
+			if(mStack.empty()) {
+				root = std::move(aValue);
+				return root;
+			}
+			value& parent = *mStack.back();
+			if(parent.get_type() == value::ARRAY_T) return parent.emplace_back(std::move(aValue));
+			return parent.get_object().emplace(mKey, std::move(aValue)).first->second;
+		}
+	public:
+		value root;
+
+		void start_object() { mStack.push_back(&add(value(value::OBJECT_T))); }
+		void end_object() { mStack.pop_back(); }
+		void start_array() { mStack.push_back(&add(value(value::ARRAY_T))); }
+		void end_array() { mStack.pop_back(); }
+		void key(const char* aName, const size_t aSize) { mKey = value::key_t(aName, aSize); }
+		void null() { add(value()); }
+		void boolean(const bool aValue) { add(value(aValue)); }
+		void number(const double aValue) { add(value(aValue)); }
+		void integer(const value::int_t aValue) { add(value(aValue)); }
+		void unsigned_integer(const value::uint_t aValue) { add(value(aValue)); }
+
+		void string(const char* aValue, const size_t aSize) {
+			value tmp;
+			tmp.set_string(aValue, aSize);
+			add(std::move(tmp));
+		}
+	};
+
+	//! \brief Writes a value tree by reference into a large buffer that is passed to the stream in chunks
+	class json_writer {
+	private:
+		enum : size_t {
+			BUFFER_SIZE = 64 * 1024
+		};
+
+		std::ostream& mStream;
+		std::unique_ptr<char[]> mBuffer;
+		char* mPosition;
+		char* const mEnd;
+		const bool mFancy;
+
+		void put(const char aChar) {
+			if(mPosition == mEnd) flush();
+			*(mPosition++) = aChar;
+		}
+
+		void write(const char* aData, const size_t aSize) {
+			if(static_cast<size_t>(mEnd - mPosition) < aSize) {
+				flush();
+				// Long strings go straight to the stream
+				if(aSize >= BUFFER_SIZE) {
+					mStream.write(aData, static_cast<std::streamsize>(aSize));
+					return;
+				}
+			}
+			std::memcpy(mPosition, aData, aSize);
+			mPosition += aSize;
+		}
+
+		template<class T>
+		void write_number(const T aValue) {
+			if(static_cast<size_t>(mEnd - mPosition) < NUMBER_BUFFER_SIZE) flush();
+			mPosition += format_number(aValue, mPosition);
+		}
+
+		//! \brief JSON has no representation for NaN or infinity, format_number would write them as "nan" and "inf"
+		void write_number(const value::number_t aValue) {
+			if(! std::isfinite(aValue)) throw std::runtime_error("json_format : NaN and infinity cannot be written as JSON");
+			if(static_cast<size_t>(mEnd - mPosition) < NUMBER_BUFFER_SIZE) flush();
+			mPosition += format_number(aValue, mPosition);
+		}
+
+		void write_escape(const char aChar) {
+			static const char HEX[] = "0123456789abcdef";
+			char tmp[6] = {'\\', aChar, '0', '0', HEX[(aChar >> 4) & 0xF], HEX[aChar & 0xF]};
+			switch(aChar) {
+			case '"':
+			case '\\':
+				break;
+			case '\b':
+				tmp[1] = 'b';
+				break;
+			case '\f':
+				tmp[1] = 'f';
+				break;
+			case '\n':
+				tmp[1] = 'n';
+				break;
+			case '\r':
+				tmp[1] = 'r';
+				break;
+			case '\t':
+				tmp[1] = 't';
+				break;
+			default:
+				tmp[1] = 'u';
+				write(tmp, 6);
+				return;
+			}
+			write(tmp, 2);
+		}
+
+		void write_string(const char* aData, const size_t aSize) {
+			put('"');
+			// Runs that need no escaping are copied in bulk
+			size_t i = 0;
+			while(true) {
+				const size_t plain = json_plain_length(aData + i, aSize - i);
+				write(aData + i, plain);
+				i += plain;
+				if(i == aSize) break;
+
+				if(static_cast<unsigned char>(aData[i]) < 0x80) {
+					write_escape(aData[i]);
+					++i;
+				}else {
+					const size_t length = utf8_sequence_length(aData + i, aSize - i);
+					if(length == 0) throw std::runtime_error("json_format : String is not valid UTF-8");
+					write(aData + i, length);
+					i += length;
+				}
+			}
+			put('"');
+		}
+
+		void indent(size_t aDepth) {
+			if(! mFancy) return;
+			while(aDepth > 0) {
+				put('\t');
+				--aDepth;
+			}
+		}
+
+		void newline() {
+			if(mFancy) put('\n');
+		}
+
+		void write_packed_array(const value::packed_array_t& aArray, const size_t aDepth) {
+			const value::packed_array_t::element_type type = aArray.get_element_type();
+			put('[');
+			newline();
+			const size_t s = aArray.size();
+			for(size_t i = 0; i < s; ++i) {
+				indent(aDepth + 1);
+				if(value::packed_array_t::is_floating_point(type)) write_number(aArray.get<value::number_t>(i));
+				else if(value::packed_array_t::is_signed(type)) write_number(aArray.get<value::int_t>(i));
+				else write_number(aArray.get<value::uint_t>(i));
+				if(i + 1 < s) put(',');
+				newline();
+			}
+			indent(aDepth);
+			put(']');
+		}
+	public:
+		json_writer(std::ostream& aStream, const bool aFancy) :
+			mStream(aStream),
+			mBuffer(new char[BUFFER_SIZE]),
+			mPosition(mBuffer.get()),
+			mEnd(mBuffer.get() + BUFFER_SIZE),
+			mFancy(aFancy)
+		{}
+
+		void flush() {
+			mStream.write(mBuffer.get(), mPosition - mBuffer.get());
+			mPosition = mBuffer.get();
+		}
+
+		void write_line(const value& aValue) {
+			write_value(aValue, 0);
+			put('\n');
+		}
+
+		void write_value(const value& aValue, const size_t aDepth) {
+			switch(aValue.get_type()) {
+			case value::NULL_T:
+				write("null", 4);
+				break;
+			case value::BOOL_T:
+				if(aValue.get_bool()) write("true", 4);
+				else write("false", 5);
+				break;
+			case value::CHAR_T:
+				{
+					const char tmp = aValue.get_char();
+					write_string(&tmp, 1);
+				}
+				break;
+			case value::NUMBER_T:
+				write_number(aValue.get_number());
+				break;
+			case value::INT_T:
+				write_number(aValue.get_int());
+				break;
+			case value::UINT_T:
+				write_number(aValue.get_uint());
+				break;
+			case value::STRING_T:
+				{
+					const value::string_ref tmp = aValue.get_string();
+					write_string(tmp.data(), tmp.size());
+				}
+				break;
+			case value::ARRAY_T:
+				{
+					put('[');
+					newline();
+					const value::array_t& tmp = aValue.get_array();
+					const size_t s = tmp.size();
+					for(size_t i = 0; i < s; ++i) {
+						indent(aDepth + 1);
+						write_value(tmp[i], aDepth + 1);
+						if(i + 1 < s) put(',');
+						newline();
+					}
+					indent(aDepth);
+					put(']');
+				}
+				break;
+			case value::PACKED_ARRAY_T:
+				write_packed_array(aValue.get_packed_array(), aDepth);
+				break;
+			case value::OBJECT_T:
+				{
+					put('{');
+					newline();
+					const value::object_t& tmp = aValue.get_object();
+					const size_t s = tmp.size();
+					size_t i = 0;
+					for(const auto& v : tmp) {
+						indent(aDepth + 1);
+						write_string(v.first.data(), v.first.size());
+						put(':');
+						write_value(v.second, aDepth + 1);
+						if(++i < s) put(',');
+						newline();
+					}
+					indent(aDepth);
+					put('}');
+				}
+				break;
+			default:
+				throw std::runtime_error("json_format : Invalid serial type");
+			}
+		}
+	};
+
+	template<class HANDLER>
+	static const char* json_read_buffer(HANDLER& aHandler, const char* aData, const size_t aSize) {
+		json_structural_index index;
+		index.build(aData, aSize);
+		json_reader<HANDLER> reader(aHandler, aData, aData + aSize, index.begin(), index.end());
+		reader.read_value();
+		return reader.position();
+	}
+
+	//! \brief Only whitespace may follow the root value of a buffer
+	static void json_expect_end(const char* aPosition, const char* const aEnd) {
+		for(; aPosition != aEnd; ++aPosition) {
+			const char c = *aPosition;
+			if(c != ' ' && c != '\t' && c != '\n' && c != '\r') {
+				throw std::runtime_error("asmith::json_format::read_serial : Unexpected data after the end of the document");
+			}
+		}
+	}
+
+	//! \brief Finds the end of the first document in some input without parsing it
+	//! \detail Brackets and strings are tracked so that reading can stop at the last byte of the document.
+	class json_document_scanner {
+	private:
+		size_t mDepth;
+		bool mStarted;
+		bool mString;
+		bool mEscape;
+	public:
+		enum result {
+			INSIDE, //!< The character belongs to the document, which continues after it
+			LAST, //!< The character is the last one of the document
+			AFTER //!< The document ended before the character
+		};
+
+		json_document_scanner() throw() :
+			mDepth(0),
+			mStarted(false),
+			mString(false),
+			mEscape(false)
+		{}
+
+		result next(const char aChar) throw() {
+			if(mString) {
+				if(mEscape) {
+					mEscape = false;
+				}else if(aChar == '\\') {
+					mEscape = true;
+				}else if(aChar == '"') {
+					mString = false;
+					if(mDepth == 0) return LAST;
+				}
+				return INSIDE;
+			}
+
+			// A number or literal at the root ends at the first delimiter, which is not part of the document
+			if(mStarted && mDepth == 0 && json_is_delimiter(aChar)) return AFTER;
+
+			switch(aChar) {
+			case ' ':
+			case '\t':
+			case '\n':
+			case '\r':
+				break;
+			case '"':
+				mString = true;
+				mStarted = true;
+				break;
+			case '{':
+			case '[':
+				++mDepth;
+				mStarted = true;
+				break;
+			case '}':
+			case ']':
+			case ',':
+			case ':':
+				if(mDepth > 0 && (aChar == '}' || aChar == ']')) --mDepth;
+				if(mDepth == 0) return LAST;
+				break;
+			default:
+				mStarted = true;
+				break;
+			}
+			return INSIDE;
+		}
+	};
+
+	//! \brief Copy the next document of a stream that cannot seek
+	//! \detail The stream buffer is read a character at a time so that anything after the document is left in it.
+	static void json_read_unseekable(std::istream& aStream, std::string& aBuffer) {
+		typedef std::istream::traits_type traits;
+
+		const std::istream::sentry sentry(aStream, true);
+		if(! sentry) return;
+		std::streambuf& buffer = *aStream.rdbuf();
+
+		json_document_scanner scanner;
+		for(traits::int_type i = buffer.sgetc(); ! traits::eq_int_type(i, traits::eof()); i = buffer.sgetc()) {
+			const char c = traits::to_char_type(i);
+			const json_document_scanner::result result = scanner.next(c);
+			if(result == json_document_scanner::AFTER) return;
+			buffer.sbumpc();
+			aBuffer += c;
+			if(result == json_document_scanner::LAST) return;
+		}
+		aStream.setstate(std::ios_base::eofbit);
+	}
+
+	//! \brief Copy the next document of a stream that can seek
+	//! \detail The stream is read in blocks until the document ends and is then moved back to the byte after it.
+	//! Blocks start small and double so that a stream of many short documents is not read far past each one.
+	static void json_read_seekable(std::istream& aStream, const std::istream::pos_type aStart, std::string& aBuffer) {
+		enum : size_t {
+			MIN_BLOCK_SIZE = 512,
+			MAX_BLOCK_SIZE = 64 * 1024
+		};
+
+		json_document_scanner scanner;
+		size_t size = 0;
+		size_t block = MIN_BLOCK_SIZE;
+		bool done = false;
+		while(! done && aStream) {
+			aBuffer.resize(size + block);
+			aStream.read(&aBuffer[size], block);
+			const size_t end = size + static_cast<size_t>(aStream.gcount());
+			while(size < end) {
+				const json_document_scanner::result result = scanner.next(aBuffer[size]);
+				if(result == json_document_scanner::AFTER) {
+					done = true;
+					break;
+				}
+				++size;
+				if(result == json_document_scanner::LAST) {
+					done = true;
+					break;
+				}
+			}
+			if(block < MAX_BLOCK_SIZE) block *= 2;
+		}
+		aBuffer.resize(size);
+		aStream.clear();
+		aStream.seekg(aStart + static_cast<std::streamoff>(size));
+	}
+
+	//! \brief Copy the next document of a stream, leaving the stream positioned after it so that following data can
+	//! still be read
+	static void json_read_document(std::istream& aStream, std::string& aBuffer) {
+		const std::istream::pos_type start = aStream.tellg();
+		if(start == std::istream::pos_type(-1)) json_read_unseekable(aStream, aBuffer);
+		else json_read_seekable(aStream, start, aBuffer);
+	}
+
+	template<class HANDLER>
+	static void json_read_stream(HANDLER& aHandler, std::istream& aStream) {
+		std::string buffer;
+		json_read_document(aStream, buffer);
+		json_read_buffer(aHandler, buffer.data(), buffer.size());
+	}
+
+	void read_json(json_parser& aParser, std::istream& aStream) {
+		json_read_stream(aParser, aStream);
+	}
+
+	void read_json(json_parser& aParser, const char* aData, const size_t aSize) {
+		json_expect_end(json_read_buffer(aParser, aData, aSize), aData + aSize);
+	}
+
+	// ndjson
+
+	//! \brief Parses every document in a buffer of complete lines
+	static void ndjson_read_chunk(const char* aData, const size_t aSize, std::vector<value>& aValues) {
+		json_structural_index index;
+		index.build(aData, aSize);
+		json_value_builder builder;
+		json_reader<json_value_builder> reader(builder, aData, aData + aSize, index.begin(), index.end());
+		bool first = true;
+		while(! reader.at_end()) {
+			if(! first) {
+				const char* const end = reader.position();
+				if(! std::memchr(end, '\n', reader.next_token() - end)) {
+					throw std::runtime_error("asmith::json_format::read_serial : Expected each NDJSON document to be on its own line");
+				}
+			}
+			first = false;
+			reader.read_value();
+			aValues.push_back(std::move(builder.root));
+		}
+	}
+
+	//! \brief Splits input into chunks that end on a line break
+	class ndjson_chunker {
+	private:
+		enum : size_t {
+			CHUNK_SIZE = 1024 * 1024
+		};
+
+		std::istream* const mStream;
+		const char* mData;
+		const char* const mEnd;
+		std::string mCarry; //!< Start of a line that did not fit in the previous chunk
+	public:
+		explicit ndjson_chunker(std::istream& aStream) :
+			mStream(&aStream),
+			mData(nullptr),
+			mEnd(nullptr)
+		{}
+
+		ndjson_chunker(const char* aData, const size_t aSize) :
+			mStream(nullptr),
+			mData(aData),
+			mEnd(aData + aSize)
+		{}
+
+		//! \brief Chunks of a stream are copied into aStorage, chunks of a buffer point into the buffer
+		//! \return False when the input has been consumed
+		bool next(std::string& aStorage, const char*& aData, size_t& aSize) {
+			if(mStream) {
+				aStorage.swap(mCarry);
+				mCarry.clear();
+				while(*mStream) {
+					const size_t size = aStorage.size();
+					aStorage.resize(size + CHUNK_SIZE);
+					mStream->read(&aStorage[size], CHUNK_SIZE);
+					aStorage.resize(size + static_cast<size_t>(mStream->gcount()));
+
+					// Keep reading until the chunk contains a line break, the partial last line is carried over
+					size_t i = aStorage.size();
+					while(i > size && aStorage[i - 1] != '\n') --i;
+					if(i > size) {
+						mCarry.assign(aStorage, i, std::string::npos);
+						aStorage.resize(i);
+						break;
+					}
+				}
+				aData = aStorage.data();
+				aSize = aStorage.size();
+				return aSize > 0;
+			}
+
+			if(mData == mEnd) return false;
+			const char* end = mEnd;
+			if(static_cast<size_t>(mEnd - mData) > CHUNK_SIZE) {
+				const void* const newline = std::memchr(mData + CHUNK_SIZE, '\n', mEnd - mData - CHUNK_SIZE);
+				if(newline) end = static_cast<const char*>(newline) + 1;
+			}
+			aData = mData;
+			aSize = end - mData;
+			mData = end;
+			return true;
+		}
+	};
+
+	// ndjson_reader
+
+	ndjson_reader::ndjson_reader(std::istream& aStream) :
+		mChunker(new ndjson_chunker(aStream)),
+		mNext(0)
+	{}
+
+	ndjson_reader::ndjson_reader(const char* aData, const size_t aSize) :
+		mChunker(new ndjson_chunker(aData, aSize)),
+		mNext(0)
+	{}
+
+	ndjson_reader::~ndjson_reader() throw() {
+
+	}
+
+	bool ndjson_reader::read(value& aValue) {
+		while(mNext == mValues.size()) {
+			mValues.clear();
+			mNext = 0;
+			const char* data;
+			size_t size;
+			if(! mChunker->next(mStorage, data, size)) return false;
+			ndjson_read_chunk(data, size, mValues);
+		}
+		aValue = std::move(mValues[mNext++]);
+		return true;
+	}
+
+	// ndjson_parallel_reader
+
+	ndjson_parallel_reader::ndjson_parallel_reader() :
+		mThreads(std::thread::hardware_concurrency()),
+		mOrdered(true)
+	{
+		if(mThreads == 0) mThreads = 1;
+	}
+
+	ndjson_parallel_reader& ndjson_parallel_reader::set_threads(const size_t aThreads) {
+		mThreads = aThreads == 0 ? 1 : aThreads;
+		return *this;
+	}
+
+	ndjson_parallel_reader& ndjson_parallel_reader::set_ordered(const bool aOrdered) {
+		mOrdered = aOrdered;
+		return *this;
+	}
+
+	void ndjson_parallel_reader::read(std::istream& aStream, const callback& aCallback) {
+		ndjson_chunker chunker(aStream);
+		read(chunker, aCallback);
+	}
+
+	void ndjson_parallel_reader::read(const char* aData, const size_t aSize, const callback& aCallback) {
+		ndjson_chunker chunker(aData, aSize);
+		read(chunker, aCallback);
+	}
+
+	void ndjson_parallel_reader::read(ndjson_chunker& aChunker, const callback& aCallback) {
+		struct job {
+			size_t index;
+			std::string storage;
+			const char* data;
+			size_t size;
+		};
+
+		std::mutex lock;
+		std::condition_variable workReady;
+		std::condition_variable resultReady;
+		std::deque<job> jobs;
+		std::map<size_t, std::vector<value>> results;
+		std::exception_ptr error;
+		bool finished = false;
+
+		const auto work = [&]() {
+			std::vector<value> values;
+			while(true) {
+				job tmp;
+				{
+					std::unique_lock<std::mutex> guard(lock);
+					workReady.wait(guard, [&]()->bool { return finished || ! jobs.empty(); });
+					if(jobs.empty()) return;
+					tmp = std::move(jobs.front());
+					jobs.pop_front();
+				}
+
+				try {
+					ndjson_read_chunk(tmp.storage.empty() ? tmp.data : tmp.storage.data(), tmp.size, values);
+				}catch(...) {
+					std::lock_guard<std::mutex> guard(lock);
+					if(! error) error = std::current_exception();
+					resultReady.notify_one();
+					return;
+				}
+
+				std::lock_guard<std::mutex> guard(lock);
+				results.emplace(tmp.index, std::move(values));
+				values.clear();
+				resultReady.notify_one();
+			}
+		};
+
+		std::vector<std::thread> workers;
+		const auto stop = [&]() {
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				finished = true;
+				jobs.clear();
+			}
+			workReady.notify_all();
+			for(std::thread& i : workers) i.join();
+		};
+
+		try {
+			for(size_t i = 0; i < mThreads; ++i) workers.emplace_back(work);
+
+			// Limit how far reading runs ahead of delivery so that memory use does not depend on the input size
+			const size_t window = mThreads * 2;
+			size_t produced = 0;
+			size_t delivered = 0;
+			bool more = true;
+			std::vector<value> values;
+			while(true) {
+				while(more && produced - delivered < window) {
+					job tmp;
+					tmp.index = produced;
+					more = aChunker.next(tmp.storage, tmp.data, tmp.size);
+					if(! more) break;
+					{
+						std::lock_guard<std::mutex> guard(lock);
+						jobs.push_back(std::move(tmp));
+					}
+					workReady.notify_one();
+					++produced;
+				}
+				if(delivered == produced) break;
+
+				{
+					std::unique_lock<std::mutex> guard(lock);
+					resultReady.wait(guard, [&]()->bool {
+						return error || (mOrdered ? results.count(delivered) != 0 : ! results.empty());
+					});
+					if(error) std::rethrow_exception(error);
+					const auto i = mOrdered ? results.find(delivered) : results.begin();
+					values = std::move(i->second);
+					results.erase(i);
+				}
+				++delivered;
+				for(value& i : values) aCallback(std::move(i));
+				values.clear();
+			}
+		}catch(...) {
+			stop();
+			throw;
+		}
+		stop();
+	}
+
+	// ndjson_writer
+
+	ndjson_writer::ndjson_writer(std::ostream& aStream) :
+		mWriter(new json_writer(aStream, false))
+	{}
+
+	ndjson_writer::~ndjson_writer() throw() {
+		try {
+			mWriter->flush();
+		}catch(...) {
+
+		}
+	}
+
+	void ndjson_writer::write(const value& aValue) {
+		mWriter->write_line(aValue);
+	}
+
+	void ndjson_writer::flush() {
+		mWriter->flush();
+	}
+
+	// json_document
+
+	json_document::json_document(const char* aData, const size_t aSize) :
+		mData(aData),
+		mSize(aSize)
+	{
+		build();
+	}
+
+	json_document::json_document(std::istream& aStream) :
+		mData(nullptr),
+		mSize(0)
+	{
+		json_read_document(aStream, mStorage);
+		mData = mStorage.data();
+		mSize = mStorage.size();
+		build();
+	}
+
+	void json_document::build() {
+		mIndex.build(mData, mSize);
+		if(mIndex.size() == 0) throw std::runtime_error("asmith::json_format::read_serial : Could not determin JSON type");
+
+		// Pair brackets up front so that skipping a container is O(1)
+		const uint32_t count = static_cast<uint32_t>(mIndex.size());
+		mClose.assign(count, 0);
+		std::vector<uint32_t> open;
+		for(uint32_t i = 0; i < count; ++i) {
+			const char c = mData[mIndex[i]];
+			if(c == '{' || c == '[') {
+				open.push_back(i);
+			}else if(c == '}' || c == ']') {
+				if(open.empty() || mData[mIndex[open.back()]] != (c == '}' ? '{' : '[')) {
+					throw std::runtime_error(c == '}' ?
+						"asmith::json_format::read_serial : Unexpected '}'" :
+						"asmith::json_format::read_serial : Unexpected ']'"
+					);
+				}
+				mClose[open.back()] = i;
+				open.pop_back();
+			}
+		}
+		if(! open.empty()) throw std::runtime_error(mData[mIndex[open.back()]] == '{' ?
+			"asmith::json_format::read_serial : Expected object to end with '}'" :
+			"asmith::json_format::read_serial : Expected array to end with ']'"
+		);
+
+		// Every token is indexed, so any token after the root value is data after the end of the document
+		if(root().skip() != count) {
+			throw std::runtime_error("asmith::json_format::read_serial : Unexpected data after the end of the document");
+		}
+	}
+
+	json_node json_document::root() const {
+		return json_node(this, 0);
+	}
+
+	// json_node
+
+	json_node::json_node(const json_document* aDocument, const uint32_t aToken) throw() :
+		mDocument(aDocument),
+		mToken(aToken)
+	{}
+
+	uint32_t json_node::close() const {
+		const char c = mDocument->mData[mDocument->mIndex[mToken]];
+		if(c != '{' && c != '[') throw std::runtime_error("json_document : Value is not an array or object");
+		return mDocument->mClose[mToken];
+	}
+
+	uint32_t json_node::skip() const {
+		const char c = mDocument->mData[mDocument->mIndex[mToken]];
+		return c == '{' || c == '[' ? mDocument->mClose[mToken] + 1 : mToken + 1;
+	}
+
+	value::type json_node::get_type() const {
+		const char* const token = mDocument->mData + mDocument->mIndex[mToken];
+		switch(*token) {
 		case 'n':
 			return value::NULL_T;
 		case 't':
 		case 'f':
 			return value::BOOL_T;
-		case '0':
-		case '1':
-		case '2':
-		case '3':
-		case '4':
-		case '5':
-		case '6':
-		case '7':
-		case '8':
-		case '9':
-		case '-':
-		case '+':
-			return value::NUMBER_T;
 		case '"':
 			return value::STRING_T;
 		case '[':
@@ -45,238 +1024,496 @@ namespace asmith { namespace serial {
 		case '{':
 			return value::OBJECT_T;
 		default:
-			throw std::runtime_error("asmith::json_format::read_serial : Could not determin JSON type");
+			{
+				parsed_number number;
+				if(! parse_number(token, mDocument->mData + mDocument->mSize, number)) {
+					throw std::runtime_error("asmith::json_format::read_serial : Could not determin JSON type");
+				}
+				return number.type;
+			}
 		}
 	}
 
-	value json_read_value(std::istream&);
+	size_t json_node::size() const {
+		const value::type type = get_type();
+		if(type != value::ARRAY_T && type != value::OBJECT_T) return 0;
+		size_t count = 0;
+		for(iterator i = begin(); i != end(); ++i) ++count;
+		return count;
+	}
 
-	value json_read_null(std::istream& aStream) {
-		skip_whitespace(aStream);
+	json_node json_node::operator[](const size_t aIndex) const {
+		iterator i = begin();
+		const iterator e = end();
+		for(size_t j = 0; j < aIndex && i != e; ++j) ++i;
+		if(i == e) throw std::runtime_error("json_document : Index is out of bounds");
+		return *i;
+	}
 
-		char buf[4];
-		aStream.read(buf, 4);
-		if(memcmp(buf, "null", 4) != 0) throw std::runtime_error("asmith::json_format::read_serial : Expected 'null'");
-		return value();
+	json_node json_node::operator[](const std::string& aName) const {
+		if(get_type() != value::OBJECT_T) throw std::runtime_error("json_document : Value is not an object");
+		const char* const last = mDocument->mData + mDocument->mSize;
+		std::string scratch;
+		const iterator e = end();
+		for(iterator i = begin(); i != e; ++i) {
+			const char* const name = mDocument->mData + mDocument->mIndex[i.mToken] + 1;
+			size_t size = json_string_end(name, last) - name;
+			const char* tmp = name;
+			if(std::memchr(name, '\\', size) && json_unescape(name, size, scratch)) {
+				tmp = scratch.data();
+				size = scratch.size();
+			}
+			if(size == aName.size() && std::memcmp(tmp, aName.data(), size) == 0) return *i;
+		}
+		throw std::runtime_error("json_document : Object does not contain object with given name");
 	}
 
-	value json_read_bool(std::istream& aStream) {
-		skip_whitespace(aStream);
+	json_node::iterator json_node::begin() const {
+		const uint32_t e = close();
+		return iterator(mDocument, mToken + 1, e, mDocument->mData[mDocument->mIndex[mToken]] == '{');
+	}
 
-		char buf[5];
-		aStream.read(buf, 4);
-		if(memcmp(buf, "true", 4) == 0) {
-			return value(true);
-		}else if(memcmp(buf, "fals", 4) == 0) {
-			aStream.read(buf, 1);
-			if(buf[0] == 'e') return value(false);
+	json_node::iterator json_node::end() const {
+		const uint32_t e = close();
+		return iterator(mDocument, e, e, mDocument->mData[mDocument->mIndex[mToken]] == '{');
+	}
+
+	value json_node::get_scalar() const {
+		// Numbers are converted by value so that the rules match a materialised document
+		const char* const token = mDocument->mData + mDocument->mIndex[mToken];
+		const char* const last = mDocument->mData + mDocument->mSize;
+		parsed_number number;
+		const char* const end = parse_number(token, last, number);
+		if(! end || (end != last && ! json_is_delimiter(*end))) return materialise();
+		switch(number.type) {
+		case value::INT_T:
+			return value(number.int_value);
+		case value::UINT_T:
+			return value(number.uint_value);
+		default:
+			return value(number.number_value);
 		}
-		throw std::runtime_error("asmith::json_format::read_serial : Expected 'true' or 'false'");
 	}
 
-	value json_read_number(std::istream& aStream) {
-		skip_whitespace(aStream);
+	value::bool_t json_node::get_bool() const {
+		return materialise().get_bool();
+	}
 
-		static const auto is_number = [](const char c)->bool {
-			return (c >= '0' && c <= '9') || c == '+' || c == '-' || c == '.' || c == 'e' || c == 'E';
-		};
+	value::number_t json_node::get_number() const {
+		return get_scalar().get_number();
+	}
 
-		char buf[32];
-		size_t s = 0;
-		char c = aStream.peek();
-		while(is_number(c)) {
-			buf[s++] = c;
-			aStream.read(&c, 1);
-			c = aStream.peek();
-		}
-		buf[s] = '\0';
-		return value(atof(buf));
-	}
-
-	value json_read_string(std::istream& aStream) {
-		skip_whitespace(aStream);
-
-		char c = aStream.peek();
-		if(c != '"') throw std::runtime_error("asmith::json_format::read_serial : Expected string to begin with '\"'");
-		aStream.read(&c, 1);
-
-		value tmp;
-		value::string_t& str = tmp.set_string();
-
-		c = aStream.peek();
-		while(c != '"') {
-			str += c;
-			aStream.read(&c, 1);
-			if(aStream.eof()) throw std::runtime_error("asmith::json_format::read_serial : Expected string to end with '\"'");
-			c = aStream.peek();
-		}
-		aStream.read(&c, 1);
-
-		return tmp;
-	}
-
-	value json_read_array(std::istream& aStream) {
-		skip_whitespace(aStream);
-
-		char c = aStream.peek();
-		if(c != '[') throw std::runtime_error("asmith::json_format::read_serial : Expected array to begin with '['");
-		aStream.read(&c, 1);
-		skip_whitespace(aStream);
-
-		value tmp;
-		value::array_t& array_ = tmp.set_array();
-
-		c = aStream.peek();
-		while(c != ']') {
-			if(aStream.eof()) throw std::runtime_error("asmith::json_format::read_serial : Expected array to end with ']'");
-			array_.push_back(json_read_value(aStream));
-			skip_whitespace(aStream);
-			c = aStream.peek();
-			if(c == ']') break;
-			else if(c != ',') throw std::runtime_error("asmith::json_format::read_serial : Expected array elements to be seperated with ','");
-			aStream.read(&c, 1);
-			skip_whitespace(aStream);
-		}
-		aStream.read(&c, 1);
-
-		return tmp;
-	}
-
-	value json_read_object(std::istream& aStream) {
-		skip_whitespace(aStream);
-
-		char c = aStream.peek();
-		if(c != '{') throw std::runtime_error("asmith::json_format::read_serial : Expected object to begin with '{'");
-		aStream.read(&c, 1);
-		skip_whitespace(aStream);
-
-		value tmp;
-		value::object_t& object = tmp.set_object();
-
-		c = aStream.peek();
-		while(c != '}') {
-			if(aStream.eof()) throw std::runtime_error("asmith::json_format::read_serial : Expected object to end with '}'");
-			const value::string_t name = json_read_string(aStream).get_string();
-			skip_whitespace(aStream);
-			aStream.read(&c, 1);
-			if(c != ':') throw std::runtime_error("asmith::json_format::read_serial : Expected object name to be end with ':'");
-			skip_whitespace(aStream);
-			object.emplace(name, json_read_value(aStream));
-			skip_whitespace(aStream);
-			c = aStream.peek();
-			if(c == '}') break;
-			else if(c != ',') throw std::runtime_error("asmith::json_format::read_serial : Expected object elements to be seperated with ','");
-			aStream.read(&c, 1);
-			skip_whitespace(aStream);
-		}
-		aStream.read(&c, 1);
-
-		return tmp;
-	}
-
-	value json_read_value(std::istream& aStream) {
-		switch(json_determine_type(aStream)) {
-		case value::NULL_T:
-			return json_read_null(aStream);
-		case value::BOOL_T:
-			return json_read_bool(aStream);
-		case value::NUMBER_T:
-			return json_read_number(aStream);
-		case value::STRING_T:
-			return json_read_string(aStream);
-		case value::ARRAY_T:
-			return json_read_array(aStream);
-		case value::OBJECT_T:
-			return json_read_object(aStream);
-		default:
-			throw std::runtime_error("asmith::json_format::read_serial : Could not determin JSON type");
+	value::int_t json_node::get_int() const {
+		return get_scalar().get_int();
+	}
+
+	value::uint_t json_node::get_uint() const {
+		return get_scalar().get_uint();
+	}
+
+	value::string_t json_node::get_string() const {
+		const value tmp = materialise();
+		const value::string_ref str = tmp.get_string();
+		return value::string_t(str.data(), str.size());
+	}
+
+	void json_node::get_string(std::string& aValue) const {
+		const char* const token = mDocument->mData + mDocument->mIndex[mToken];
+		if(*token != '"') {
+			const value tmp = materialise();
+			const value::string_ref str = tmp.get_string();
+			aValue.assign(str.data(), str.size());
+			return;
 		}
+		const char* const begin = token + 1;
+		const size_t size = json_string_end(begin, mDocument->mData + mDocument->mSize) - begin;
+		if(! json_unescape(begin, size, aValue)) aValue.assign(begin, size);
 	}
 
-	// json_format
+	value json_node::materialise() const {
+		json_value_builder builder;
+		json_reader<json_value_builder> reader(
+			builder,
+			mDocument->mData,
+			mDocument->mData + mDocument->mSize,
+			mDocument->mIndex.begin() + mToken,
+			mDocument->mIndex.end()
+		);
+		reader.read_value();
+		return std::move(builder.root);
+	}
 
+	// json_node::iterator
 
-	json_format::json_format() :
-		mFancy(false)
-	{}
+	json_node::iterator::iterator(const json_document* aDocument, const uint32_t aToken, const uint32_t aEnd, const bool aObject) :
+		mDocument(aDocument),
+		mToken(aToken),
+		mEnd(aEnd),
+		mObject(aObject)
+	{
+		check();
+	}
 
-	json_format& json_format::set_fancy_writing(const bool aOption) {
-		mFancy = aOption;
+	void json_node::iterator::check() const {
+		if(mToken == mEnd) return;
+		uint32_t element = mToken;
+		if(mObject) {
+			if(mDocument->mData[mDocument->mIndex[mToken]] != '"') {
+				throw std::runtime_error("asmith::json_format::read_serial : Expected string to begin with '\"'");
+			}
+			if(mToken + 2 >= mEnd || mDocument->mData[mDocument->mIndex[mToken + 1]] != ':') {
+				throw std::runtime_error("asmith::json_format::read_serial : Expected object name to be end with ':'");
+			}
+			element = mToken + 2;
+		}
+		switch(mDocument->mData[mDocument->mIndex[element]]) {
+		case ',':
+		case ':':
+		case ']':
+		case '}':
+			throw std::runtime_error("asmith::json_format::read_serial : Could not determin JSON type");
+		default:
+			break;
+		}
+	}
+
+	json_node json_node::iterator::operator*() const {
+		return json_node(mDocument, mObject ? mToken + 2 : mToken);
+	}
+
+	json_node::iterator& json_node::iterator::operator++() {
+		const uint32_t next = operator*().skip();
+		if(next == mEnd) {
+			mToken = mEnd;
+			return *this;
+		}
+		if(next > mEnd || mDocument->mData[mDocument->mIndex[next]] != ',') throw std::runtime_error(mObject ?
+			"asmith::json_format::read_serial : Expected object elements to be seperated with ','" :
+			"asmith::json_format::read_serial : Expected array elements to be seperated with ','"
+		);
+		// A trailing comma is accepted, as it is by json_format
+		mToken = next + 1;
+		check();
 		return *this;
 	}
 
-	void json_format::write_serial_internal(size_t aDepth, const value& aType, std::ostream& aStream) {
-		const auto indent = [&]()->void {
-			for(size_t i = 0; i < aDepth; ++i) aStream << '\t';
-		};
-		const value::type tBuf = aType.get_type();
+	bool json_node::iterator::operator==(const iterator& aOther) const throw() {
+		return mToken == aOther.mToken && mDocument == aOther.mDocument;
+	}
+
+	bool json_node::iterator::operator!=(const iterator& aOther) const throw() {
+		return ! operator==(aOther);
+	}
+
+	value::string_t json_node::iterator::key() const {
+		if(! mObject) throw std::runtime_error("json_document : Value is not an object");
+		const char* const name = mDocument->mData + mDocument->mIndex[mToken] + 1;
+		const size_t size = json_string_end(name, mDocument->mData + mDocument->mSize) - name;
+		std::string scratch;
+		if(json_unescape(name, size, scratch)) return value::string_t(scratch.data(), scratch.size());
+		return value::string_t(name, size);
+	}
+
+	void json_node::iterator::key(std::string& aName) const {
+		if(! mObject) throw std::runtime_error("json_document : Value is not an object");
+		const char* const name = mDocument->mData + mDocument->mIndex[mToken] + 1;
+		const size_t size = json_string_end(name, mDocument->mData + mDocument->mSize) - name;
+		if(! json_unescape(name, size, aName)) aName.assign(name, size);
+	}
+
+	// json_push_parser
+
+	//! \brief Adapts json_value_builder to json_parser so that the push parser can build values
+	class json_value_parser : public json_parser {
+	public:
+		json_value_builder builder;
+
+		void start_object() override { builder.start_object(); }
+		void end_object() override { builder.end_object(); }
+		void start_array() override { builder.start_array(); }
+		void end_array() override { builder.end_array(); }
+		void key(const char* aName, const size_t aSize) override { builder.key(aName, aSize); }
+		void null() override { builder.null(); }
+		void boolean(const bool aValue) override { builder.boolean(aValue); }
+		void number(const double aValue) override { builder.number(aValue); }
+		void integer(const value::int_t aValue) override { builder.integer(aValue); }
+		void unsigned_integer(const value::uint_t aValue) override { builder.unsigned_integer(aValue); }
+		void string(const char* aValue, const size_t aSize) override { builder.string(aValue, aSize); }
+	};
+
+	json_push_parser::json_push_parser() :
+		mHandler(nullptr),
+		mBuilder(new json_value_parser()),
+		mConsumed(0),
+		mState(START),
+		mEscape(false),
+		mKey(false)
+	{
+		mHandler = mBuilder.get();
+	}
+
+	json_push_parser::json_push_parser(json_parser& aHandler) :
+		mHandler(&aHandler),
+		mConsumed(0),
+		mState(START),
+		mEscape(false),
+		mKey(false)
+	{}
+
+	json_push_parser::~json_push_parser() throw() {
+
+	}
 
-		switch(tBuf) {
-		case value::NULL_T:
-			aStream << "null";
+	void json_push_parser::begin_value(const char aChar) {
+		if((aChar == '{' || aChar == '[') && mStack.size() >= JSON_MAX_DEPTH) {
+			throw std::runtime_error("asmith::json_format::read_serial : Values are nested too deeply");
+		}
+		switch(aChar) {
+		case '{':
+			mHandler->start_object();
+			mStack.push_back('{');
+			mState = OBJECT_START;
 			break;
-		case value::BOOL_T:
-			aStream << (aType.get_bool() ? "true" : "false");
+		case '[':
+			mHandler->start_array();
+			mStack.push_back('[');
+			mState = ARRAY_START;
 			break;
-		case value::CHAR_T:
-			aStream << '"' << aType.get_char() << '"';
+		case '"':
+			mToken.clear();
+			mKey = false;
+			mState = STRING;
 			break;
-		case value::NUMBER_T:
-			aStream << aType.get_number();
+		default:
+			if(json_is_delimiter(aChar)) throw std::runtime_error("asmith::json_format::read_serial : Could not determin JSON type");
+			mToken.clear();
+			mState = SCALAR;
+			break;
+		}
+	}
+
+	void json_push_parser::end_value() throw() {
+		mState = mStack.empty() ? DONE : AFTER_VALUE;
+	}
+
+	void json_push_parser::end_string() {
+		const char* str = mToken.data();
+		size_t size = mToken.size();
+		if(json_unescape(str, size, mScratch)) {
+			str = mScratch.data();
+			size = mScratch.size();
+		}
+		if(mKey) {
+			mHandler->key(str, size);
+			mState = COLON;
+		}else {
+			mHandler->string(str, size);
+			end_value();
+		}
+	}
+
+	void json_push_parser::end_scalar() {
+		switch(mToken[0]) {
+		case 'n':
+			if(mToken != "null") throw std::runtime_error("asmith::json_format::read_serial : Expected 'null'");
+			mHandler->null();
 			break;
-		case value::STRING_T:
-			aStream << '"' << aType.get_string() << '"';
+		case 't':
+			if(mToken != "true") throw std::runtime_error("asmith::json_format::read_serial : Expected 'true' or 'false'");
+			mHandler->boolean(true);
 			break;
-		case value::ARRAY_T:
+		case 'f':
+			if(mToken != "false") throw std::runtime_error("asmith::json_format::read_serial : Expected 'true' or 'false'");
+			mHandler->boolean(false);
+			break;
+		default:
 			{
-				aStream << '[';
-				if(mFancy) aStream << '\n';
-				++aDepth;
-				const value::array_t tmp = aType.get_array();
-				const size_t s = tmp.size();
-				for(size_t i = 0; i < s; ++i) {
-					if(mFancy) indent();
-					write_serial_internal(aDepth, tmp[i], aStream);
-					if(i + 1 < s) aStream << ',';
-					if(mFancy) aStream << '\n';
+				const char* const end = mToken.data() + mToken.size();
+				parsed_number number;
+				if(parse_number(mToken.data(), end, number) != end) {
+					throw std::runtime_error("asmith::json_format::read_serial : Expected number");
+				}
+				switch(number.type) {
+				case value::INT_T:
+					mHandler->integer(number.int_value);
+					break;
+				case value::UINT_T:
+					mHandler->unsigned_integer(number.uint_value);
+					break;
+				default:
+					mHandler->number(number.number_value);
+					break;
 				}
-				--aDepth;
-				if(mFancy) indent();
-				aStream << ']';
 			}
 			break;
-		case value::OBJECT_T:
-		{
-			aStream << '{';
-			if(mFancy) aStream << '\n';
-			++aDepth;
-			const value::object_t tmp = aType.get_object();
-			const size_t s = tmp.size();
-			size_t i = 0;
-			for(const auto& v : tmp) {
-				if(mFancy) indent();
-				aStream << '"' << v.first<< '"' << ':';
-				write_serial_internal(aDepth, v.second, aStream);
-				if(i + 1 < s) aStream << ',';
-				if(mFancy) aStream << '\n';
+		}
+		end_value();
+	}
+
+	json_push_parser::status json_push_parser::feed(const char* aData, const size_t aSize) {
+		const char* i = aData;
+		const char* const end = aData + aSize;
+		while(i != end && mState != DONE) {
+			if(mState == STRING) {
+				// Copy runs of plain characters in bulk, escapes are decoded once the string is complete
+				while(i != end) {
+					if(mEscape) {
+						mToken += *(i++);
+						mEscape = false;
+						continue;
+					}
+					const size_t plain = json_plain_length(i, end - i);
+					mToken.append(i, plain);
+					i += plain;
+					if(i == end) break;
+					const char c = *(i++);
+					if(c == '"') {
+						end_string();
+						break;
+					}
+					mToken += c;
+					mEscape = c == '\\';
+				}
+				continue;
+			}
+
+			if(mState == SCALAR) {
+				const char* const begin = i;
+				while(i != end && ! json_is_delimiter(*i)) ++i;
+				mToken.append(begin, i);
+				if(i != end) end_scalar();
+				continue;
+			}
+
+			const char c = *i;
+			if(c == ' ' || c == '\t' || c == '\n' || c == '\r') {
 				++i;
+				continue;
 			}
-			--aDepth;
-			if(mFancy) indent();
-			aStream << '}';
+
+			switch(mState) {
+			case START:
+			case VALUE:
+				begin_value(c);
+				break;
+			case ARRAY_START:
+				// A trailing comma is accepted, as it is by json_format
+				if(c == ']') {
+					mStack.pop_back();
+					mHandler->end_array();
+					end_value();
+				}else {
+					begin_value(c);
+				}
+				break;
+			case OBJECT_START:
+				if(c == '}') {
+					mStack.pop_back();
+					mHandler->end_object();
+					end_value();
+				}else if(c == '"') {
+					mToken.clear();
+					mKey = true;
+					mState = STRING;
+				}else {
+					throw std::runtime_error("asmith::json_format::read_serial : Expected string to begin with '\"'");
+				}
+				break;
+			case COLON:
+				if(c != ':') throw std::runtime_error("asmith::json_format::read_serial : Expected object name to be end with ':'");
+				mState = VALUE;
+				break;
+			case AFTER_VALUE:
+				if(mStack.back() == '[') {
+					if(c == ',') {
+						mState = ARRAY_START;
+					}else if(c == ']') {
+						mStack.pop_back();
+						mHandler->end_array();
+						end_value();
+					}else {
+						throw std::runtime_error("asmith::json_format::read_serial : Expected array elements to be seperated with ','");
+					}
+				}else {
+					if(c == ',') {
+						mState = OBJECT_START;
+					}else if(c == '}') {
+						mStack.pop_back();
+						mHandler->end_object();
+						end_value();
+					}else {
+						throw std::runtime_error("asmith::json_format::read_serial : Expected object elements to be seperated with ','");
+					}
+				}
+				break;
+			default:
+				break;
+			}
+			if(mState != SCALAR) ++i;
 		}
-		break;
-		default:
-			throw std::runtime_error("json_format : Invalid serial type");
-			break;
+
+		mConsumed = i - aData;
+		return mState == DONE ? COMPLETE : NEED_MORE_INPUT;
+	}
+
+	json_push_parser::status json_push_parser::finish() {
+		if(mState == SCALAR && mStack.empty()) end_scalar();
+		if(mState != DONE) throw std::runtime_error(mState == START ?
+			"asmith::json_format::read_serial : Could not determin JSON type" :
+			"asmith::json_format::read_serial : Unexpected end of document"
+		);
+		return COMPLETE;
+	}
+
+	size_t json_push_parser::consumed() const throw() {
+		return mConsumed;
+	}
+
+	value json_push_parser::take() {
+		if(! mBuilder || mState != DONE) throw std::runtime_error("json_push_parser : No document has been completed");
+		return std::move(static_cast<json_value_parser&>(*mBuilder).builder.root);
+	}
+
+	void json_push_parser::reset() {
+		if(mBuilder) {
+			mBuilder.reset(new json_value_parser());
+			mHandler = mBuilder.get();
 		}
+		mStack.clear();
+		mToken.clear();
+		mConsumed = 0;
+		mState = START;
+		mEscape = false;
+		mKey = false;
+	}
+
+	// json_format
+
+
+	json_format::json_format() :
+		mFancy(false)
+	{}
+
+	json_format& json_format::set_fancy_writing(const bool aOption) {
+		mFancy = aOption;
+		return *this;
 	}
 
 	void json_format::write_serial(const value& aType, std::ostream& aStream) {
-		write_serial_internal(0, aType, aStream);
+		json_writer writer(aStream, mFancy);
+		writer.write_value(aType, 0);
+		writer.flush();
 	}
 
 	value json_format::read_serial(std::istream& aStream) {
-		return json_read_value(aStream);
+		json_value_builder builder;
+		json_read_stream(builder, aStream);
+		return std::move(builder.root);
+	}
+
+	value json_format::read_serial(const char* aData, const size_t aSize) {
+		json_value_builder builder;
+		json_expect_end(json_read_buffer(builder, aData, aSize), aData + aSize);
+		return std::move(builder.root);
 	}
 }}
\ No newline at end of file
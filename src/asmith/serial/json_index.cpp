@@ -0,0 +1,247 @@
+//	Copyright 2017 Adam Smith
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+
+#include "asmith/serial/json_index.hpp"
+#include <cstring>
+#include <stdexcept>
+
+// Define ASMITH_SERIAL_NO_SIMD to always use the scalar classifier
+#if (defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)) && ! defined(ASMITH_SERIAL_NO_SIMD)
+	#define ASMITH_SERIAL_X86
+	#include <immintrin.h>
+	#ifdef _MSC_VER
+		#include <intrin.h>
+		#define SV_TARGET_AVX2
+	#else
+		#define SV_TARGET_AVX2 __attribute__((target("avx2")))
+	#endif
+#endif
+
+#ifdef _MSC_VER
+	#include <intrin.h>
+#endif
+
+namespace asmith { namespace serial {
+
+	// Bit i of each mask describes byte i of a 64 byte block
+	struct sv_json_block {
+		uint64_t backslash;
+		uint64_t quote;
+		uint64_t whitespace;
+		uint64_t op;
+	};
+
+	typedef void(*sv_json_classifier)(const char*, sv_json_block&);
+
+#ifndef ASMITH_SERIAL_X86
+	static void sv_classify_scalar(const char* aBlock, sv_json_block& aMasks) {
+		aMasks.backslash = 0;
+		aMasks.quote = 0;
+		aMasks.whitespace = 0;
+		aMasks.op = 0;
+		for(uint32_t i = 0; i < 64; ++i) {
+			const uint64_t bit = 1ull << i;
+			switch(aBlock[i]) {
+			case '\\':
+				aMasks.backslash |= bit;
+				break;
+			case '"':
+				aMasks.quote |= bit;
+				break;
+			case ' ':
+			case '\t':
+			case '\n':
+			case '\r':
+				aMasks.whitespace |= bit;
+				break;
+			case '{':
+			case '}':
+			case '[':
+			case ']':
+			case ':':
+			case ',':
+				aMasks.op |= bit;
+				break;
+			default:
+				break;
+			}
+		}
+	}
+#else
+	static uint32_t sv_match_sse2(const __m128i aChars, const char aValue) {
+		return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(aChars, _mm_set1_epi8(aValue))));
+	}
+
+	static void sv_classify_sse2(const char* aBlock, sv_json_block& aMasks) {
+		aMasks.backslash = 0;
+		aMasks.quote = 0;
+		aMasks.whitespace = 0;
+		aMasks.op = 0;
+		for(uint32_t i = 0; i < 64; i += 16) {
+			const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aBlock + i));
+			aMasks.backslash |= static_cast<uint64_t>(sv_match_sse2(chars, '\\')) << i;
+			aMasks.quote |= static_cast<uint64_t>(sv_match_sse2(chars, '"')) << i;
+			aMasks.whitespace |= static_cast<uint64_t>(
+				sv_match_sse2(chars, ' ') | sv_match_sse2(chars, '\t') |
+				sv_match_sse2(chars, '\n') | sv_match_sse2(chars, '\r')
+			) << i;
+			aMasks.op |= static_cast<uint64_t>(
+				sv_match_sse2(chars, '{') | sv_match_sse2(chars, '}') |
+				sv_match_sse2(chars, '[') | sv_match_sse2(chars, ']') |
+				sv_match_sse2(chars, ':') | sv_match_sse2(chars, ',')
+			) << i;
+		}
+	}
+
+	SV_TARGET_AVX2 static uint32_t sv_match_avx2(const __m256i aChars, const char aValue) {
+		return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(aChars, _mm256_set1_epi8(aValue))));
+	}
+
+	SV_TARGET_AVX2 static void sv_classify_avx2(const char* aBlock, sv_json_block& aMasks) {
+		aMasks.backslash = 0;
+		aMasks.quote = 0;
+		aMasks.whitespace = 0;
+		aMasks.op = 0;
+		for(uint32_t i = 0; i < 64; i += 32) {
+			const __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aBlock + i));
+			aMasks.backslash |= static_cast<uint64_t>(sv_match_avx2(chars, '\\')) << i;
+			aMasks.quote |= static_cast<uint64_t>(sv_match_avx2(chars, '"')) << i;
+			aMasks.whitespace |= static_cast<uint64_t>(
+				sv_match_avx2(chars, ' ') | sv_match_avx2(chars, '\t') |
+				sv_match_avx2(chars, '\n') | sv_match_avx2(chars, '\r')
+			) << i;
+			aMasks.op |= static_cast<uint64_t>(
+				sv_match_avx2(chars, '{') | sv_match_avx2(chars, '}') |
+				sv_match_avx2(chars, '[') | sv_match_avx2(chars, ']') |
+				sv_match_avx2(chars, ':') | sv_match_avx2(chars, ',')
+			) << i;
+		}
+	}
+
+	static bool sv_has_avx2() {
+	#ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 0);
+		if(info[0] < 7) return false;
+		__cpuid(info, 1);
+		// The OS must save the YMM registers
+		if(! (info[2] & (1 << 27)) || (_xgetbv(0) & 6) != 6) return false;
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+	#else
+		return __builtin_cpu_supports("avx2") != 0;
+	#endif
+	}
+#endif
+
+	struct sv_json_implementation {
+		sv_json_classifier classify;
+		const char* name;
+	};
+
+	static const sv_json_implementation& sv_get_implementation() {
+		static const sv_json_implementation IMPLEMENTATION =
+	#ifdef ASMITH_SERIAL_X86
+			sv_has_avx2() ? sv_json_implementation{sv_classify_avx2, "avx2"} : sv_json_implementation{sv_classify_sse2, "sse2"};
+	#else
+			sv_json_implementation{sv_classify_scalar, "scalar"};
+	#endif
+		return IMPLEMENTATION;
+	}
+
+	static uint32_t sv_ctz(const uint64_t aValue) throw() {
+	#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+		unsigned long tmp;
+		_BitScanForward64(&tmp, aValue);
+		return tmp;
+	#elif defined(_MSC_VER)
+		unsigned long tmp;
+		if(_BitScanForward(&tmp, static_cast<unsigned long>(aValue))) return tmp;
+		_BitScanForward(&tmp, static_cast<unsigned long>(aValue >> 32));
+		return tmp + 32;
+	#else
+		return __builtin_ctzll(aValue);
+	#endif
+	}
+
+	static uint64_t sv_prefix_xor(uint64_t aValue) throw() {
+		aValue ^= aValue << 1;
+		aValue ^= aValue << 2;
+		aValue ^= aValue << 4;
+		aValue ^= aValue << 8;
+		aValue ^= aValue << 16;
+		aValue ^= aValue << 32;
+		return aValue;
+	}
+
+	// json_structural_index
+
+	void json_structural_index::build(const char* aData, const size_t aSize) {
+		if(aSize > UINT32_MAX) throw std::runtime_error("asmith::json_format::read_serial : Document is larger than 4 GiB");
+
+		const sv_json_classifier classify = sv_get_implementation().classify;
+		const uint64_t EVEN_BITS = 0x5555555555555555ull;
+
+		mPositions.clear();
+		mPositions.reserve(aSize / 4);
+
+		// State carried between blocks
+		uint64_t prevEscaped = 0;
+		uint64_t prevInString = 0;
+		uint64_t prevScalar = 0;
+
+		char tail[64];
+		sv_json_block masks;
+
+		for(size_t offset = 0; offset < aSize; offset += 64) {
+			const char* block = aData + offset;
+			if(aSize - offset < 64) {
+				// Whitespace padding cannot start a token or extend one
+				std::memset(tail, ' ', sizeof(tail));
+				std::memcpy(tail, block, aSize - offset);
+				block = tail;
+			}
+			classify(block, masks);
+
+			// Characters preceded by an odd number of backslashes are escaped
+			uint64_t backslash = masks.backslash & ~prevEscaped;
+			const uint64_t followsEscape = (backslash << 1) | prevEscaped;
+			const uint64_t oddStarts = backslash & ~EVEN_BITS & ~followsEscape;
+			const uint64_t evenStarts = oddStarts + backslash;
+			prevEscaped = evenStarts < oddStarts ? 1 : 0;
+			const uint64_t escaped = (EVEN_BITS ^ (evenStarts << 1)) & followsEscape;
+
+			// Strings include their opening quote but not their closing quote
+			const uint64_t quote = masks.quote & ~escaped;
+			const uint64_t inString = sv_prefix_xor(quote) ^ prevInString;
+			prevInString = static_cast<uint64_t>(static_cast<int64_t>(inString) >> 63);
+
+			const uint64_t op = masks.op & ~inString;
+			const uint64_t scalar = ~(masks.op | masks.whitespace | quote | inString);
+			const uint64_t scalarStarts = scalar & ~((scalar << 1) | prevScalar);
+			prevScalar = scalar >> 63;
+
+			uint64_t structurals = op | (quote & inString) | scalarStarts;
+			while(structurals != 0) {
+				mPositions.push_back(static_cast<uint32_t>(offset + sv_ctz(structurals)));
+				structurals &= structurals - 1;
+			}
+		}
+
+		if(prevInString) throw std::runtime_error("asmith::json_format::read_serial : Expected string to end with '\"'");
+	}
+
+	const char* json_structural_index::implementation() throw() {
+		return sv_get_implementation().name;
+	}
+}}
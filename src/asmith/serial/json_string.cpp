@@ -0,0 +1,241 @@
+//	Copyright 2017 Adam Smith
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+
+#include "asmith/serial/json_string.hpp"
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+// Define ASMITH_SERIAL_NO_SIMD to always use the portable scan
+#if (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)) && ! defined(ASMITH_SERIAL_NO_SIMD)
+	#define ASMITH_SERIAL_SSE2
+	#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+	#include <intrin.h>
+#endif
+
+namespace asmith { namespace serial {
+
+	static bool sv_is_plain(const unsigned char aChar) throw() {
+		return aChar >= 0x20 && aChar < 0x80 && aChar != '"' && aChar != '\\';
+	}
+
+#ifdef ASMITH_SERIAL_SSE2
+	static uint32_t sv_ctz(const uint32_t aValue) throw() {
+	#ifdef _MSC_VER
+		unsigned long tmp;
+		_BitScanForward(&tmp, aValue);
+		return tmp;
+	#else
+		return __builtin_ctz(aValue);
+	#endif
+	}
+#endif
+
+	size_t json_plain_length(const char* aData, const size_t aSize) throw() {
+		size_t i = 0;
+	#ifdef ASMITH_SERIAL_SSE2
+		const __m128i quote = _mm_set1_epi8('"');
+		const __m128i backslash = _mm_set1_epi8('\\');
+		const __m128i space = _mm_set1_epi8(' ');
+		for(; i + 16 <= aSize; i += 16) {
+			const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aData + i));
+			// The signed comparison also catches bytes of 0x80 and above
+			const __m128i special = _mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi8(chars, quote), _mm_cmpeq_epi8(chars, backslash)),
+				_mm_cmplt_epi8(chars, space)
+			);
+			const uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(special));
+			if(mask != 0) return i + sv_ctz(mask);
+		}
+	#else
+		// Sets the high bit of every byte that is below 0x20, '"' or '\\', or that already has its high bit set
+		const uint64_t ONES = 0x0101010101010101ull;
+		const uint64_t HIGH = 0x8080808080808080ull;
+		for(; i + 8 <= aSize; i += 8) {
+			uint64_t word;
+			std::memcpy(&word, aData + i, sizeof(word));
+			const uint64_t quote = word ^ (ONES * '"');
+			const uint64_t backslash = word ^ (ONES * '\\');
+			const uint64_t special = ((word - ONES * 0x20) & ~word) | ((quote - ONES) & ~quote) | ((backslash - ONES) & ~backslash) | word;
+			if((special & HIGH) != 0) break;
+		}
+	#endif
+		while(i < aSize && sv_is_plain(static_cast<unsigned char>(aData[i]))) ++i;
+		return i;
+	}
+
+	size_t utf8_sequence_length(const char* aData, const size_t aSize) throw() {
+		const unsigned char* const bytes = reinterpret_cast<const unsigned char*>(aData);
+		if(aSize == 0) return 0;
+		const unsigned char first = bytes[0];
+		if(first < 0x80) return 1;
+
+		// Second byte ranges exclude overlong encodings, surrogates and code points above U+10FFFF
+		size_t length;
+		unsigned char low = 0x80;
+		unsigned char high = 0xBF;
+		if(first >= 0xC2 && first <= 0xDF) {
+			length = 2;
+		}else if(first >= 0xE0 && first <= 0xEF) {
+			length = 3;
+			if(first == 0xE0) low = 0xA0;
+			else if(first == 0xED) high = 0x9F;
+		}else if(first >= 0xF0 && first <= 0xF4) {
+			length = 4;
+			if(first == 0xF0) low = 0x90;
+			else if(first == 0xF4) high = 0x8F;
+		}else {
+			return 0;
+		}
+
+		if(aSize < length) return 0;
+		if(bytes[1] < low || bytes[1] > high) return 0;
+		for(size_t i = 2; i < length; ++i) {
+			if((bytes[i] & 0xC0) != 0x80) return 0;
+		}
+		return length;
+	}
+
+	static uint32_t sv_read_hex(const char* aData) {
+		uint32_t tmp = 0;
+		for(int i = 0; i < 4; ++i) {
+			const char c = aData[i];
+			tmp <<= 4;
+			if(c >= '0' && c <= '9') tmp |= c - '0';
+			else if(c >= 'a' && c <= 'f') tmp |= c - 'a' + 10;
+			else if(c >= 'A' && c <= 'F') tmp |= c - 'A' + 10;
+			else throw std::runtime_error("asmith::json_format::read_serial : Expected 4 hexadecimal digits after '\\u'");
+		}
+		return tmp;
+	}
+
+	static void sv_append_utf8(const uint32_t aCodePoint, std::string& aOutput) {
+		char tmp[4];
+		size_t size;
+		if(aCodePoint < 0x80) {
+			tmp[0] = static_cast<char>(aCodePoint);
+			size = 1;
+		}else if(aCodePoint < 0x800) {
+			tmp[0] = static_cast<char>(0xC0 | (aCodePoint >> 6));
+			tmp[1] = static_cast<char>(0x80 | (aCodePoint & 0x3F));
+			size = 2;
+		}else if(aCodePoint < 0x10000) {
+			tmp[0] = static_cast<char>(0xE0 | (aCodePoint >> 12));
+			tmp[1] = static_cast<char>(0x80 | ((aCodePoint >> 6) & 0x3F));
+			tmp[2] = static_cast<char>(0x80 | (aCodePoint & 0x3F));
+			size = 3;
+		}else {
+			tmp[0] = static_cast<char>(0xF0 | (aCodePoint >> 18));
+			tmp[1] = static_cast<char>(0x80 | ((aCodePoint >> 12) & 0x3F));
+			tmp[2] = static_cast<char>(0x80 | ((aCodePoint >> 6) & 0x3F));
+			tmp[3] = static_cast<char>(0x80 | (aCodePoint & 0x3F));
+			size = 4;
+		}
+		aOutput.append(tmp, size);
+	}
+
+	// Decodes the escape sequence at aData[aIndex] and returns the index after it
+	static size_t sv_unescape(const char* aData, const size_t aSize, size_t aIndex, std::string& aOutput) {
+		if(aIndex + 1 >= aSize) throw std::runtime_error("asmith::json_format::read_serial : Expected escape sequence after '\\'");
+		switch(aData[aIndex + 1]) {
+		case '"':
+			aOutput += '"';
+			break;
+		case '\\':
+			aOutput += '\\';
+			break;
+		case '/':
+			aOutput += '/';
+			break;
+		case 'b':
+			aOutput += '\b';
+			break;
+		case 'f':
+			aOutput += '\f';
+			break;
+		case 'n':
+			aOutput += '\n';
+			break;
+		case 'r':
+			aOutput += '\r';
+			break;
+		case 't':
+			aOutput += '\t';
+			break;
+		case 'u':
+			{
+				if(aSize - aIndex < 6) throw std::runtime_error("asmith::json_format::read_serial : Expected 4 hexadecimal digits after '\\u'");
+				uint32_t codePoint = sv_read_hex(aData + aIndex + 2);
+				aIndex += 6;
+				if(codePoint >= 0xDC00 && codePoint <= 0xDFFF) {
+					throw std::runtime_error("asmith::json_format::read_serial : Unpaired UTF-16 surrogate in '\\u' escape");
+				}else if(codePoint >= 0xD800 && codePoint <= 0xDBFF) {
+					if(aSize - aIndex < 6 || aData[aIndex] != '\\' || aData[aIndex + 1] != 'u') {
+						throw std::runtime_error("asmith::json_format::read_serial : Unpaired UTF-16 surrogate in '\\u' escape");
+					}
+					const uint32_t low = sv_read_hex(aData + aIndex + 2);
+					if(low < 0xDC00 || low > 0xDFFF) {
+						throw std::runtime_error("asmith::json_format::read_serial : Unpaired UTF-16 surrogate in '\\u' escape");
+					}
+					codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+					aIndex += 6;
+				}
+				sv_append_utf8(codePoint, aOutput);
+			}
+			return aIndex;
+		default:
+			throw std::runtime_error("asmith::json_format::read_serial : Invalid escape sequence");
+		}
+		return aIndex + 2;
+	}
+
+	// Returns the index after the non-plain character at aData[aIndex], or aIndex if it is a '\\'
+	static size_t sv_skip_special(const char* aData, const size_t aSize, const size_t aIndex) {
+		const unsigned char c = static_cast<unsigned char>(aData[aIndex]);
+		if(c == '\\') return aIndex;
+		if(c == '"') return aIndex + 1;
+		if(c < 0x20) throw std::runtime_error("asmith::json_format::read_serial : Control characters must be escaped in strings");
+		const size_t length = utf8_sequence_length(aData + aIndex, aSize - aIndex);
+		if(length == 0) throw std::runtime_error("asmith::json_format::read_serial : String is not valid UTF-8");
+		return aIndex + length;
+	}
+
+	bool json_unescape(const char* aData, const size_t aSize, std::string& aOutput) {
+		// Validate in place until the first escape so that most strings are never copied
+		size_t i = json_plain_length(aData, aSize);
+		while(i < aSize) {
+			const size_t next = sv_skip_special(aData, aSize, i);
+			if(next == i) break;
+			i = next + json_plain_length(aData + next, aSize - next);
+		}
+		if(i == aSize) return false;
+
+		aOutput.assign(aData, i);
+		while(i < aSize) {
+			const size_t next = sv_skip_special(aData, aSize, i);
+			if(next == i) {
+				i = sv_unescape(aData, aSize, i, aOutput);
+			}else {
+				aOutput.append(aData + i, next - i);
+				i = next;
+			}
+			const size_t plain = json_plain_length(aData + i, aSize - i);
+			aOutput.append(aData + i, plain);
+			i += plain;
+		}
+		return true;
+	}
+}}
@@ -0,0 +1,207 @@
+//	Copyright 2017 Adam Smith
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+//
+//	http://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+
+#include "asmith/serial/key.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <vector>
+#include "asmith/serial/arena.hpp"
+#include "asmith/serial/flat_map.hpp"
+
+namespace asmith { namespace serial {
+
+	typedef interned_key::entry sv_key_entry;
+
+	static bool sv_key_equals(const sv_key_entry* aEntry, const char* aString, const size_t aSize, const size_t aHash) throw() {
+		return aEntry->hash == aHash && aEntry->size == aSize && std::memcmp(aEntry->data(), aString, aSize) == 0;
+	}
+
+	static const struct {
+		sv_key_entry header;
+		char data;
+	} SV_EMPTY_KEY = {{static_cast<size_t>(14695981039346656037ull), 0}, '\0'}; // FNV-1a of ""
+
+	enum : size_t {
+		SV_KEY_TABLE_LIMIT = 64 * 1024 //!< Names in the table are never freed, so it stops growing at this size
+	};
+
+	// Open addressing table of interned names, entries are never freed
+	struct sv_key_table {
+		std::mutex lock;
+		std::vector<const sv_key_entry*> slots;
+		size_t size;
+
+		sv_key_table() :
+			slots(1024, nullptr),
+			size(0)
+		{}
+
+		const sv_key_entry* find(const char* aString, const size_t aSize, const size_t aHash) const throw() {
+			const size_t mask = slots.size() - 1;
+			size_t i = aHash & mask;
+			while(const sv_key_entry* const tmp = slots[i]) {
+				if(sv_key_equals(tmp, aString, aSize, aHash)) return tmp;
+				i = (i + 1) & mask;
+			}
+			return nullptr;
+		}
+
+		void insert(const sv_key_entry* aEntry) throw() {
+			const size_t mask = slots.size() - 1;
+			size_t i = aEntry->hash & mask;
+			while(slots[i]) i = (i + 1) & mask;
+			slots[i] = aEntry;
+		}
+
+		void grow() {
+			std::vector<const sv_key_entry*> tmp(slots.size() * 2, nullptr);
+			tmp.swap(slots);
+			for(const sv_key_entry* i : tmp) if(i) insert(i);
+		}
+	};
+
+	static sv_key_table& sv_get_key_table() {
+		// Never destroyed so that keys held by static values remain valid during shutdown
+		static sv_key_table* const TABLE = new sv_key_table();
+		return *TABLE;
+	}
+
+	static sv_key_entry* sv_create_key_entry(void* aMemory, const char* aString, const size_t aSize, const size_t aHash) throw() {
+		sv_key_entry* const entry = static_cast<sv_key_entry*>(aMemory);
+		entry->hash = aHash;
+		entry->size = aSize;
+		char* const data = reinterpret_cast<char*>(entry + 1);
+		std::memcpy(data, aString, aSize);
+		data[aSize] = '\0';
+		return entry;
+	}
+
+	// Entries that are not in the table are preceded by their reference count
+	typedef std::atomic<size_t> sv_key_counter;
+
+	enum : size_t {
+		SV_KEY_COUNTER_SIZE = ((sizeof(sv_key_counter) + alignof(sv_key_entry) - 1) / alignof(sv_key_entry)) * alignof(sv_key_entry)
+	};
+
+	static sv_key_counter& sv_key_references(const sv_key_entry* aEntry) throw() {
+		return *reinterpret_cast<sv_key_counter*>(const_cast<char*>(reinterpret_cast<const char*>(aEntry)) - SV_KEY_COUNTER_SIZE);
+	}
+
+	static const sv_key_entry* sv_create_owned_key(const char* aString, const size_t aSize, const size_t aHash) {
+		char* const memory = static_cast<char*>(std::malloc(SV_KEY_COUNTER_SIZE + sizeof(sv_key_entry) + aSize + 1));
+		if(! memory) throw std::bad_alloc();
+		new(memory) sv_key_counter(1);
+		return sv_create_key_entry(memory + SV_KEY_COUNTER_SIZE, aString, aSize, aHash);
+	}
+
+	// Each thread remembers recently used names so that repeated keys do not contend on the table lock
+	enum : size_t {
+		SV_KEY_CACHE_SIZE = 256
+	};
+
+	static thread_local const sv_key_entry* SV_KEY_CACHE[SV_KEY_CACHE_SIZE];
+
+	// interned_key
+
+	interned_key::interned_key() throw() :
+		mEntry(reinterpret_cast<uintptr_t>(&SV_EMPTY_KEY.header))
+	{}
+
+	uintptr_t interned_key::create_owned(const char* aString, const size_t aSize, const size_t aHash) {
+		value_arena* const arena = value_arena::get_current();
+		if(arena) {
+			void* const memory = arena->allocate(sizeof(sv_key_entry) + aSize + 1, alignof(sv_key_entry));
+			return reinterpret_cast<uintptr_t>(sv_create_key_entry(memory, aString, aSize, aHash)) | OWNED_FLAG | ARENA_FLAG;
+		}
+		return reinterpret_cast<uintptr_t>(sv_create_owned_key(aString, aSize, aHash)) | OWNED_FLAG;
+	}
+
+	uintptr_t interned_key::copy(const uintptr_t aEntry) {
+		const sv_key_entry* const entry = reinterpret_cast<const sv_key_entry*>(aEntry & ~static_cast<uintptr_t>(OWNED_FLAG | ARENA_FLAG));
+
+		// A copy made while a scope is active may be part of an arena backed tree, and a copy of an arena entry may
+		// outlive the arena, so neither can share the entry
+		if((aEntry & ARENA_FLAG) || value_arena::get_current()) return create_owned(entry->data(), entry->size, entry->hash);
+
+		sv_key_references(entry).fetch_add(1, std::memory_order_relaxed);
+		return aEntry;
+	}
+
+	void interned_key::release(const uintptr_t aEntry) throw() {
+		const sv_key_entry* const entry = reinterpret_cast<const sv_key_entry*>(aEntry & ~static_cast<uintptr_t>(OWNED_FLAG));
+		sv_key_counter& references = sv_key_references(entry);
+		if(references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			references.~sv_key_counter();
+			std::free(&references);
+		}
+	}
+
+	bool interned_key::lookup(const char* aString, const size_t aSize, interned_key& aKey) {
+		if(aSize == 0) {
+			aKey = interned_key();
+			return true;
+		}
+		const size_t hash = string_hash()(aString, aSize);
+
+		const sv_key_entry*& cached = SV_KEY_CACHE[hash & (SV_KEY_CACHE_SIZE - 1)];
+		if(cached && sv_key_equals(cached, aString, aSize, hash)) {
+			aKey = interned_key(reinterpret_cast<uintptr_t>(cached));
+			return true;
+		}
+
+		sv_key_table& table = sv_get_key_table();
+		std::unique_lock<std::mutex> lock(table.lock);
+		const sv_key_entry* const tmp = table.find(aString, aSize, hash);
+		if(tmp) {
+			cached = tmp;
+			aKey = interned_key(reinterpret_cast<uintptr_t>(tmp));
+			return true;
+		}
+
+		// Once the table is full a name that is not in it may still be held by owned keys
+		if(table.size < SV_KEY_TABLE_LIMIT) return false;
+		lock.unlock();
+		aKey = interned_key(reinterpret_cast<uintptr_t>(sv_create_owned_key(aString, aSize, hash)) | OWNED_FLAG);
+		return true;
+	}
+
+	uintptr_t interned_key::intern(const char* aString, const size_t aSize) {
+		if(aSize == 0) return reinterpret_cast<uintptr_t>(&SV_EMPTY_KEY.header);
+		const size_t hash = string_hash()(aString, aSize);
+
+		const sv_key_entry*& cached = SV_KEY_CACHE[hash & (SV_KEY_CACHE_SIZE - 1)];
+		if(cached && sv_key_equals(cached, aString, aSize, hash)) return reinterpret_cast<uintptr_t>(cached);
+
+		sv_key_table& table = sv_get_key_table();
+		std::unique_lock<std::mutex> lock(table.lock);
+		const sv_key_entry* tmp = table.find(aString, aSize, hash);
+		if(! tmp) {
+			if(table.size >= SV_KEY_TABLE_LIMIT) {
+				lock.unlock();
+				return create_owned(aString, aSize, hash);
+			}
+
+			void* const memory = std::malloc(sizeof(sv_key_entry) + aSize + 1);
+			if(! memory) throw std::bad_alloc();
+			tmp = sv_create_key_entry(memory, aString, aSize, hash);
+
+			if((table.size + 1) * 2 > table.slots.size()) table.grow();
+			table.insert(tmp);
+			++table.size;
+		}
+		cached = tmp;
+		return reinterpret_cast<uintptr_t>(tmp);
+	}
+}}
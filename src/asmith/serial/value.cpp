@@ -12,7 +12,15 @@
 //	limitations under the License.
 
 #include "asmith/serial/value.hpp"
+#include "asmith/serial/number.hpp"
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <new>
 	
 namespace asmith { namespace serial {
 
@@ -31,14 +39,98 @@ namespace asmith { namespace serial {
 		return a == b;
 	}
 
+	// sv_shared
+
+	template<class T>
+	struct sv_shared {
+		typedef std::atomic<uint32_t> counter_t;
+
+		// The reference count and cached hash are stored after the payload in the same allocation
+		enum : size_t {
+			COUNTER_OFFSET = ((sizeof(T) + alignof(counter_t) - 1) / alignof(counter_t)) * alignof(counter_t),
+			HASH_OFFSET = COUNTER_OFFSET + sizeof(counter_t)
+		};
+
+		static counter_t& references(const T* aData) throw() {
+			return *reinterpret_cast<counter_t*>(const_cast<char*>(reinterpret_cast<const char*>(aData)) + COUNTER_OFFSET);
+		}
+
+		static counter_t& hash(const T* aData) throw() {
+			return *reinterpret_cast<counter_t*>(const_cast<char*>(reinterpret_cast<const char*>(aData)) + HASH_OFFSET);
+		}
+
+		template<class T2>
+		static T* create(T2&& aData) {
+			void* const memory = ::operator new(HASH_OFFSET + sizeof(counter_t));
+			T* const data = new(memory) T(std::forward<T2>(aData));
+			new(static_cast<char*>(memory) + COUNTER_OFFSET) counter_t(1);
+			new(static_cast<char*>(memory) + HASH_OFFSET) counter_t(0);
+			return data;
+		}
+
+		static T* acquire(T* aData) throw() {
+			references(aData).fetch_add(1, std::memory_order_relaxed);
+			return aData;
+		}
+
+		static void release(T* aData) throw() {
+			if(references(aData).fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				hash(aData).~counter_t();
+				references(aData).~counter_t();
+				aData->~T();
+				::operator delete(aData);
+			}
+		}
+
+		//! \brief Move the payload out of shared storage, or copy it when there are other references
+		static T take(T* aData) {
+			if(references(aData).load(std::memory_order_acquire) == 1) {
+				T tmp(std::move(*aData));
+				release(aData);
+				return tmp;
+			}
+			T tmp(static_cast<const T&>(*aData));
+			release(aData);
+			return tmp;
+		}
+	};
+
+	// packed_array
+
+	static value sv_packed_element(const value::packed_array_t& aArray, const size_t aIndex) throw() {
+		const value::packed_array_t::element_type type = aArray.get_element_type();
+		if(value::packed_array_t::is_floating_point(type)) return value(aArray.get<value::number_t>(aIndex));
+		if(value::packed_array_t::is_signed(type)) return value(aArray.get<value::int_t>(aIndex));
+		return value(aArray.get<value::uint_t>(aIndex));
+	}
+
+	static bool sv_packed_equal(const value::packed_array_t& aPacked, const value::array_t& aArray) throw() {
+		const size_t s = aPacked.size();
+		if(s != aArray.size()) return false;
+		for(size_t i = 0; i < s; ++i) if(sv_packed_element(aPacked, i) != aArray[i]) return false;
+		return true;
+	}
+
 	// value
 
+	char* value::short_string() throw() {
+		// The characters start in the union and run up to the type
+		static_assert(offsetof(value, mType) == SHORT_STRING_CAPACITY, "value : Short strings do not fit before the type");
+		return reinterpret_cast<char*>(this);
+	}
+
+	const char* value::short_string() const throw() {
+		return reinterpret_cast<const char*>(this);
+	}
+
 	value::value() throw() :
-		mType(NULL_T)
+		mType(NULL_T),
+		mFlags(0)
 	{}
 
 	value::value(const type aType) throw() :
-		mType(NULL_T)
+		mType(NULL_T),
+		mFlags(0)
 	{
 		switch(aType) {
 		case NULL_T:
@@ -53,8 +145,14 @@ namespace asmith { namespace serial {
 		case NUMBER_T:
 			set_number();
 			break;
+		case INT_T:
+			set_int();
+			break;
+		case UINT_T:
+			set_uint();
+			break;
 		case STRING_T:
-			set_string();
+			set_string("", 0);
 			break;
 		case ARRAY_T:
 			set_array();
@@ -62,21 +160,26 @@ namespace asmith { namespace serial {
 		case OBJECT_T:
 			set_object();
 			break;
+		case PACKED_ARRAY_T:
+			set_packed_array();
+			break;
 		default:
 			break;
 		}
 	}
 
 	value::value(const value& aOther) throw() :
-		mType(NULL_T)
+		mType(NULL_T),
+		mFlags(0)
 	{
-		operator=(aOther);
+		copy_from(aOther);
 	}
 
 	value::value(value&& aOther) throw() :
-		mType(NULL_T)
+		mType(NULL_T),
+		mFlags(0)
 	{
-		operator=(std::move(aOther));
+		move_from(aOther);
 	}
 
 	value::~value() throw() {
@@ -84,9 +187,49 @@ namespace asmith { namespace serial {
 	}
 
 	value& value::operator=(const value& aOther) throw() {
+		if(this == &aOther) return *this;
+		// aOther may be part of this tree, so it is copied before the current payload is released
+		value tmp(aOther);
+		set_null();
+		move_from(tmp);
+		return *this;
+	}
+
+	value& value::operator=(value&& aOther) throw() {
+		if(this == &aOther) return *this;
+		// aOther may be part of this tree, so it is taken before the current payload is released
+		value tmp(std::move(aOther));
+		set_null();
+		move_from(tmp);
+		return *this;
+	}
+
+	void value::copy_from(const value& aOther) {
+		// Arena backed trees are never destroyed and could not release a reference, so they copy shared payloads
+		if((aOther.mFlags & SHARED_FLAG) && ! value_arena::get_current()) {
+			switch(aOther.mType) {
+			case STRING_T:
+				mString = sv_shared<string_t>::acquire(aOther.mString);
+				break;
+			case ARRAY_T:
+				mArray = sv_shared<array_t>::acquire(aOther.mArray);
+				break;
+			case OBJECT_T:
+				mObject = sv_shared<object_t>::acquire(aOther.mObject);
+				break;
+			case PACKED_ARRAY_T:
+				mPackedArray = sv_shared<packed_array_t>::acquire(aOther.mPackedArray);
+				break;
+			default:
+				break;
+			}
+			mType = aOther.mType;
+			mFlags = SHARED_FLAG;
+			return;
+		}
+
 		switch(aOther.mType) {
 		case NULL_T:
-			set_null();
 			break;
 		case BOOL_T:
 			set_bool() = aOther.mBool;
@@ -97,8 +240,17 @@ namespace asmith { namespace serial {
 		case NUMBER_T:
 			set_number() = aOther.mNumber;
 			break;
+		case INT_T:
+			set_int() = aOther.mInt;
+			break;
+		case UINT_T:
+			set_uint() = aOther.mUint;
+			break;
 		case STRING_T:
-			set_string() = *aOther.mString;
+			{
+				const string_ref tmp = aOther.get_string();
+				set_string(tmp.data(), tmp.size());
+			}
 			break;
 		case ARRAY_T:
 			set_array() = *aOther.mArray;
@@ -106,23 +258,48 @@ namespace asmith { namespace serial {
 		case OBJECT_T:
 			set_object() = *aOther.mObject;
 			break;
+		case PACKED_ARRAY_T:
+			set_packed_array() = *aOther.mPackedArray;
+			break;
 		default:
 			break;
 		}
-		return *this;
 	}
 
-	value& value::operator=(value&& aOther) throw() {
-		uint8_t buf[sizeof(value)];
-		memcpy(buf, this, sizeof(value));
-		memcpy(this, &aOther, sizeof(value));
-		memcpy(&aOther, buf, sizeof(value));
-		return *this;
+	void value::move_from(value& aOther) throw() {
+		// Every payload is a scalar, a pointer or a short string, so it can be relocated bitwise
+		std::memcpy(short_string(), aOther.short_string(), SHORT_STRING_CAPACITY);
+		mType = aOther.mType;
+		mFlags = aOther.mFlags;
+		aOther.mArray = nullptr;
+		aOther.mType = NULL_T;
+		aOther.mFlags = 0;
 	}
 
 	bool value::operator==(const value& aOther) const throw() {
 		//! \todo Conversions
-		if(mType != aOther.mType) return false;
+		if(mType != aOther.mType) {
+			// Integers and numbers compare by value so that documents round trip through text formats
+			const auto is_numeric = [](const type aType)->bool {
+				return aType == NUMBER_T || aType == INT_T || aType == UINT_T;
+			};
+			// Packed arrays are equal to arrays of the same numbers
+			if(mType == PACKED_ARRAY_T && aOther.mType == ARRAY_T) return sv_packed_equal(*mPackedArray, *aOther.mArray);
+			if(mType == ARRAY_T && aOther.mType == PACKED_ARRAY_T) return sv_packed_equal(*aOther.mPackedArray, *mArray);
+			if(! (is_numeric(mType) && is_numeric(aOther.mType))) return false;
+			if(mType == NUMBER_T || aOther.mType == NUMBER_T) return get_number() == aOther.get_number();
+			if(mType == INT_T) return mInt >= 0 && static_cast<uint_t>(mInt) == aOther.mUint;
+			return aOther.mInt >= 0 && static_cast<uint_t>(aOther.mInt) == mUint;
+		}
+
+		if(mFlags & aOther.mFlags & SHARED_FLAG) {
+			if(mArray == aOther.mArray) return true;
+
+			// Only hashes that have already been calculated are compared, equality never pays for hashing
+			const uint32_t hash1 = cached_hash()->load(std::memory_order_relaxed);
+			const uint32_t hash2 = aOther.cached_hash()->load(std::memory_order_relaxed);
+			if(hash1 != 0 && hash2 != 0 && hash1 != hash2) return false;
+		}
 
 		switch (mType) {
 		case NULL_T:
@@ -133,12 +310,23 @@ namespace asmith { namespace serial {
 			return mChar == aOther.mChar;
 		case NUMBER_T:
 			return mNumber == aOther.mNumber;
+		case INT_T:
+			return mInt == aOther.mInt;
+		case UINT_T:
+			return mUint == aOther.mUint;
 		case STRING_T:
-			return *mString == *aOther.mString;
+			return get_string() == aOther.get_string();
 		case ARRAY_T:
 			return *mArray == *aOther.mArray;
 		case OBJECT_T:
 			return *mObject == *aOther.mObject;
+		case PACKED_ARRAY_T:
+			if(mPackedArray->get_element_type() == aOther.mPackedArray->get_element_type()) return *mPackedArray == *aOther.mPackedArray;
+			if(mPackedArray->size() != aOther.mPackedArray->size()) return false;
+			for(size_t i = 0; i < mPackedArray->size(); ++i) {
+				if(sv_packed_element(*mPackedArray, i) != sv_packed_element(*aOther.mPackedArray, i)) return false;
+			}
+			return true;
 		default:
 			return false;
 		}
@@ -149,10 +337,14 @@ namespace asmith { namespace serial {
 	}
 
 	value& value::operator[](const size_t aIndex) {
+		// Packed elements are not values, so they are unpacked before one is modified
+		if(mType == PACKED_ARRAY_T) return get_array()[aIndex];
+		detach();
 		return const_cast<value&>(const_cast<const value*>(this)->operator[](aIndex));
 	}
 
 	value& value::operator[](const std::string& aIndex) {
+		detach();
 		return const_cast<value&>(const_cast<const value*>(this)->operator[](aIndex));
 	}
 
@@ -161,11 +353,9 @@ namespace asmith { namespace serial {
 		case ARRAY_T:
 			return mArray->operator[](aIndex);
 		case OBJECT_T:
-		{
-			auto i = mObject->begin();
-			for(size_t j = 0; j < aIndex; ++j) ++i;
-			return i->second;
-		}
+			return std::next(mObject->begin(), aIndex)->second;
+		case PACKED_ARRAY_T:
+			throw std::runtime_error("value : Elements of a packed array are read with get_packed_array()");
 		default:
 			throw std::runtime_error("value : Value is not an array or object");
 		}
@@ -173,20 +363,27 @@ namespace asmith { namespace serial {
 
 	const value& value::operator[](const std::string& aIndex) const {
 		if(mType != OBJECT_T) throw std::runtime_error("value : Value is not an object");
-		const auto i = mObject->find(aIndex);
+		key_t key;
+		const auto i = key_t::lookup(aIndex.c_str(), aIndex.size(), key) ? mObject->find(key) : mObject->end();
 		if(i == mObject->end()) throw std::runtime_error("value : Object does not contain object with given name");
 		return i->second;
 	}
 
 	value& value::add_member(const std::string& aKey, const value& aValue) {
-		return get_object().emplace(aKey, aValue).first->second;
+		return get_object().emplace(key_t(aKey), aValue).first->second;
+	}
+
+	value& value::add_member(const std::string& aKey, value&& aValue) {
+		return get_object().emplace(key_t(aKey), std::move(aValue)).first->second;
 	}
 
 	value value::remove_member(const std::string& aKey) {
 		object_t& object = get_object();
-		const auto i = object.find(aKey);
+		key_t key;
+		if(! key_t::lookup(aKey.c_str(), aKey.size(), key)) return value();
+		const auto i = object.find(key);
 		if(i == object.end()) return value();
-		const value tmp = std::move(i->second);
+		value tmp = std::move(i->second);
 		object.erase(i);
 		return tmp;
 	}
@@ -197,23 +394,57 @@ namespace asmith { namespace serial {
 		return array_.back();
 	}
 
+	value& value::push_back(value&& aValue) {
+		array_t& array_ = get_array();
+		array_.push_back(std::move(aValue));
+		return array_.back();
+	}
+
 	value value::pop_back() {
 		array_t& array_ = get_array();
-		const value tmp = std::move(array_.back());
+		value tmp = std::move(array_.back());
 		array_.pop_back();
 		return tmp;
 	}
 
+	void value::reserve(const size_t aSize) {
+		switch(mType) {
+		case STRING_T:
+			if(aSize > SHORT_STRING_CAPACITY || ! (mFlags & SHORT_STRING_FLAG)) get_string().reserve(aSize);
+			break;
+		case ARRAY_T:
+			get_array().reserve(aSize);
+			break;
+		case PACKED_ARRAY_T:
+			get_packed_array().reserve(aSize);
+			break;
+#ifdef ASMITH_SERIAL_FLAT_OBJECT
+		case OBJECT_T:
+			get_object().reserve(aSize);
+			break;
+#endif
+		default:
+			break;
+		}
+	}
+
 	void value::clear() {
 		switch(mType) {
 		case STRING_T:
-			mString->clear();
+			if(mFlags & SHORT_STRING_FLAG) {
+				mFlags = SHORT_STRING_FLAG;
+			}else {
+				get_string().clear();
+			}
 			break;
 		case ARRAY_T:
-			mArray->clear();
+			get_array().clear();
 			break;
 		case OBJECT_T:
-			mObject->clear();
+			get_object().clear();
+			break;
+		case PACKED_ARRAY_T:
+			get_packed_array().clear();
 			break;
 		default:
 			break;
@@ -221,13 +452,192 @@ namespace asmith { namespace serial {
 	}
 
 	size_t value::size() const throw() {
-		return mType == ARRAY_T ? mArray->size() : mType == OBJECT_T ? mObject->size() : 0;
+		switch(mType) {
+		case ARRAY_T:
+			return mArray->size();
+		case OBJECT_T:
+			return mObject->size();
+		case PACKED_ARRAY_T:
+			return mPackedArray->size();
+		default:
+			return 0;
+		}
 	}
 
 	value::type value::get_type() const throw() {
 		return mType;
 	}
 
+	void value::share() {
+		if(mFlags & (SHARED_FLAG | ARENA_FLAG)) return;
+
+		// Shared payloads always live on the heap so they can outlive any arena
+		const value_arena::scope scope(nullptr);
+
+		switch(mType) {
+		case STRING_T:
+			if(! (mFlags & SHORT_STRING_FLAG)) {
+				string_t* const tmp = sv_shared<string_t>::create(std::move(*mString));
+				delete mString;
+				mString = tmp;
+				mFlags |= SHARED_FLAG;
+			}
+			break;
+		case ARRAY_T:
+			{
+				for(value& i : *mArray) i.share();
+				array_t* const tmp = sv_shared<array_t>::create(std::move(*mArray));
+				delete mArray;
+				mArray = tmp;
+				mFlags |= SHARED_FLAG;
+			}
+			break;
+		case OBJECT_T:
+			{
+				for(auto& i : *mObject) i.second.share();
+				object_t* const tmp = sv_shared<object_t>::create(std::move(*mObject));
+				delete mObject;
+				mObject = tmp;
+				mFlags |= SHARED_FLAG;
+			}
+			break;
+		case PACKED_ARRAY_T:
+			{
+				packed_array_t* const tmp = sv_shared<packed_array_t>::create(std::move(*mPackedArray));
+				delete mPackedArray;
+				mPackedArray = tmp;
+				mFlags |= SHARED_FLAG;
+			}
+			break;
+		default:
+			break;
+		}
+	}
+
+	bool value::is_shared() const throw() {
+		return (mFlags & SHARED_FLAG) != 0;
+	}
+
+	static uint64_t sv_mix(uint64_t aValue) throw() {
+		// splitmix64 finaliser
+		aValue ^= aValue >> 30;
+		aValue *= 0xbf58476d1ce4e5b9ull;
+		aValue ^= aValue >> 27;
+		aValue *= 0x94d049bb133111ebull;
+		aValue ^= aValue >> 31;
+		return aValue;
+	}
+
+	static uint64_t sv_hash_number(const double aValue) throw() {
+		// Integral values below 2^53 are exact in every numeric type, larger values compare as doubles
+		if(aValue == std::floor(aValue) && std::fabs(aValue) < 9007199254740992.0) {
+			return static_cast<uint64_t>(static_cast<int64_t>(aValue));
+		}
+		uint64_t bits;
+		std::memcpy(&bits, &aValue, sizeof(bits));
+		return bits;
+	}
+
+	std::atomic<uint32_t>* value::cached_hash() const throw() {
+		if(! (mFlags & SHARED_FLAG)) return nullptr;
+		switch(mType) {
+		case STRING_T:
+			return &sv_shared<string_t>::hash(mString);
+		case ARRAY_T:
+			return &sv_shared<array_t>::hash(mArray);
+		case OBJECT_T:
+			return &sv_shared<object_t>::hash(mObject);
+		case PACKED_ARRAY_T:
+			return &sv_shared<packed_array_t>::hash(mPackedArray);
+		default:
+			return nullptr;
+		}
+	}
+
+	size_t value::hash() const throw() {
+		// Shared payloads cannot be modified, so their hash is calculated once
+		std::atomic<uint32_t>* const cache = cached_hash();
+		uint32_t tmp = cache ? cache->load(std::memory_order_relaxed) : 0;
+		if(tmp != 0) return tmp;
+
+		enum : uint64_t {
+			NUMERIC_SEED = 0x100
+		};
+
+		uint64_t hash;
+		switch(mType) {
+		case BOOL_T:
+			hash = sv_mix(mBool ? 1 : 2);
+			break;
+		case CHAR_T:
+			hash = sv_mix(static_cast<uint8_t>(mChar) + (CHAR_T << 8));
+			break;
+		case NUMBER_T:
+			hash = sv_mix(sv_hash_number(mNumber) + NUMERIC_SEED);
+			break;
+		case INT_T:
+			hash = sv_mix((mInt > -9007199254740992ll && mInt < 9007199254740992ll ?
+				static_cast<uint64_t>(mInt) : sv_hash_number(static_cast<double>(mInt))) + NUMERIC_SEED);
+			break;
+		case UINT_T:
+			hash = sv_mix((mUint < 9007199254740992ull ?
+				mUint : sv_hash_number(static_cast<double>(mUint))) + NUMERIC_SEED);
+			break;
+		case STRING_T:
+			hash = sv_mix(string_hash()(get_string()) + STRING_T);
+			break;
+		case ARRAY_T:
+			// Element order is significant
+			hash = ARRAY_T;
+			for(const value& i : *mArray) hash = sv_mix(hash + i.hash());
+			break;
+		case PACKED_ARRAY_T:
+			// Hashed as the equivalent array of numbers so that both compare equal
+			hash = ARRAY_T;
+			for(size_t i = 0; i < mPackedArray->size(); ++i) hash = sv_mix(hash + sv_packed_element(*mPackedArray, i).hash());
+			break;
+		case OBJECT_T:
+			// Members are combined commutatively so that the hash does not depend on storage order
+			hash = sv_mix(OBJECT_T);
+			for(const auto& i : *mObject) hash += sv_mix(i.first.hash() ^ (static_cast<uint64_t>(i.second.hash()) << 32));
+			break;
+		default:
+			hash = 0;
+			break;
+		}
+
+		tmp = static_cast<uint32_t>(hash ^ (hash >> 32));
+		if(tmp == 0) tmp = 1;
+		if(cache) cache->store(tmp, std::memory_order_relaxed);
+		return tmp;
+	}
+
+	void value::detach() {
+		if(! (mFlags & SHARED_FLAG)) return;
+
+		const value_arena::scope scope(nullptr);
+
+		// The payload always leaves shared storage, even when this is the only reference, so that it can never be
+		// modified while a hash is cached for it
+		switch(mType) {
+		case STRING_T:
+			mString = new string_t(sv_shared<string_t>::take(mString));
+			break;
+		case ARRAY_T:
+			mArray = new array_t(sv_shared<array_t>::take(mArray));
+			break;
+		case OBJECT_T:
+			mObject = new object_t(sv_shared<object_t>::take(mObject));
+			break;
+		case PACKED_ARRAY_T:
+			mPackedArray = new packed_array_t(sv_shared<packed_array_t>::take(mPackedArray));
+			break;
+		default:
+			break;
+		}
+		mFlags &= ~SHARED_FLAG;
+	}
+
 	value::bool_t value::get_bool() const {
 		switch(mType) {
 		case BOOL_T:
@@ -255,23 +665,30 @@ namespace asmith { namespace serial {
 		case NUMBER_T:
 			return mNumber >= 0.5;
 			break;
+		case INT_T:
+			return mInt > 0;
+		case UINT_T:
+			return mUint > 0;
 		case STRING_T:
-			if(
-				sv_strcmp(mString->c_str(), "0") ||
-				sv_strcmp(mString->c_str(), "n") ||
-				sv_strcmp(mString->c_str(), "f") ||
-				sv_strcmp(mString->c_str(), "zero") ||
-				sv_strcmp(mString->c_str(), "no") ||
-				sv_strcmp(mString->c_str(), "false") 
-			) return false;
-			if(
-				sv_strcmp(mString->c_str(), "1") ||
-				sv_strcmp(mString->c_str(), "y") ||
-				sv_strcmp(mString->c_str(), "t") ||
-				sv_strcmp(mString->c_str(), "one") ||
-				sv_strcmp(mString->c_str(), "yes") ||
-				sv_strcmp(mString->c_str(), "true") 
-			) return true;
+			{
+				const std::string tmp = get_string().str();
+				if(
+					sv_strcmp(tmp.c_str(), "0") ||
+					sv_strcmp(tmp.c_str(), "n") ||
+					sv_strcmp(tmp.c_str(), "f") ||
+					sv_strcmp(tmp.c_str(), "zero") ||
+					sv_strcmp(tmp.c_str(), "no") ||
+					sv_strcmp(tmp.c_str(), "false")
+				) return false;
+				if(
+					sv_strcmp(tmp.c_str(), "1") ||
+					sv_strcmp(tmp.c_str(), "y") ||
+					sv_strcmp(tmp.c_str(), "t") ||
+					sv_strcmp(tmp.c_str(), "one") ||
+					sv_strcmp(tmp.c_str(), "yes") ||
+					sv_strcmp(tmp.c_str(), "true")
+				) return true;
+			}
 			break;
 		default:
 			break;
@@ -294,8 +711,14 @@ namespace asmith { namespace serial {
 			if(tmp == mNumber && tmp >= 0 && tmp <= 9) return '0' + tmp;
 		}
 		break;
+		case INT_T:
+			if(mInt >= 0 && mInt <= 9) return static_cast<char_t>('0' + mInt);
+			break;
+		case UINT_T:
+			if(mUint <= 9) return static_cast<char_t>('0' + mUint);
+			break;
 		case STRING_T:
-			if(! mString->empty()) return mString->front();
+			if(! get_string().empty()) return get_string().front();
 			break;
 		default:
 			break;
@@ -315,9 +738,13 @@ namespace asmith { namespace serial {
 		case NUMBER_T:
 			return mNumber;
 			break;
+		case INT_T:
+			return static_cast<number_t>(mInt);
+		case UINT_T:
+			return static_cast<number_t>(mUint);
 		case STRING_T:
 			try {
-				return std::stold(mString->c_str());
+				return std::stold(get_string().str());
 			}catch (...) {
 
 			}
@@ -329,73 +756,144 @@ namespace asmith { namespace serial {
 		throw std::runtime_error("value : Value is not convertable to number");
 	}
 
-	const value::string_t& value::get_string() const {
+	value::int_t value::get_int() const {
 		switch(mType) {
 		case BOOL_T:
-			{
-				const bool_t tmp = mBool;
-				const_cast<value*>(this)->set_string() = (tmp ? "true" : "false");
-				return *mString;
-			}
+			return mBool ? 1 : 0;
 		case CHAR_T:
-			{
-				const char buf[2] = {mChar, '\0'};
-				const_cast<value*>(this)->set_string() = buf;
-				return *mString;
-			}
+			if(mChar >= '0' && mChar <= '9') return mChar - '0';
 			break;
 		case NUMBER_T:
-			{
-				const number_t tmp = mNumber;
-				const_cast<value*>(this)->set_string() = std::to_string(tmp);
-				return *mString;
+			return static_cast<int_t>(mNumber);
+		case INT_T:
+			return mInt;
+		case UINT_T:
+			return static_cast<int_t>(mUint);
+		case STRING_T:
+			try {
+				return std::stoll(get_string().str());
+			}catch (...) {
+
 			}
 			break;
+		default:
+			break;
+		}
+
+		throw std::runtime_error("value : Value is not convertable to int");
+	}
+
+	value::uint_t value::get_uint() const {
+		switch(mType) {
+		case BOOL_T:
+			return mBool ? 1 : 0;
+		case CHAR_T:
+			if(mChar >= '0' && mChar <= '9') return mChar - '0';
+			break;
+		case NUMBER_T:
+			return static_cast<uint_t>(mNumber);
+		case INT_T:
+			return static_cast<uint_t>(mInt);
+		case UINT_T:
+			return mUint;
 		case STRING_T:
-			return *mString;
+			try {
+				return std::stoull(get_string().str());
+			}catch (...) {
+
+			}
 			break;
 		default:
 			break;
 		}
 
-		throw std::runtime_error("value : Value is not convertable to string");
+		throw std::runtime_error("value : Value is not convertable to uint");
+	}
+
+	value::string_ref value::get_string() const {
+		if(mType != STRING_T) throw std::runtime_error("value : Value is not a string, use as_string() to convert it");
+		if(mFlags & SHORT_STRING_FLAG) return string_ref(short_string(), mFlags >> SHORT_STRING_SHIFT);
+		return string_ref(mString->data(), mString->size());
 	}
 
 	const value::array_t& value::get_array() const {
-		switch(mType) {
-		case ARRAY_T:
-			return *mArray;
-		case OBJECT_T:
-		{
-			value tmp;
-			const object_t& object = *mObject;
-			array_t& array_ = tmp.set_array();
-			const size_t s = object.size();
-
-			// Check if object keys are contiguous indices
-			auto j = object.begin();
-			for(size_t i = 0; i < s; ++i, ++j) {
-				array_.push_back(atof(j->first.c_str()));
-			}
+		if(mType == PACKED_ARRAY_T) throw std::runtime_error("value : Value is a packed array, use get_packed_array() or as_array() to read it");
+		if(mType != ARRAY_T) throw std::runtime_error("value : Value is not an array, use as_array() to convert it");
+		return *mArray;
+	}
 
-			std::sort(array_.begin(), array_.end(), [](const value& a, const value& b)->bool {
-				return a.mNumber < b.mNumber;
-			});
+	const value::object_t& value::get_object() const {
+		if(mType != OBJECT_T) throw std::runtime_error("value : Value is not an object, use as_object() to convert it");
+		return *mObject;
+	}
 
-			j = object.begin();
-			for(size_t i = 0; i < s; ++i, ++j) {
-				if(array_[i].mNumber != static_cast<number_t>(i)) throw std::runtime_error("value : Value is not convertable to array");
-			}
+	const value::packed_array_t& value::get_packed_array() const {
+		if(mType != PACKED_ARRAY_T) throw std::runtime_error("value : Value is not a packed array, use as_packed_array() to convert it");
+		return *mPackedArray;
+	}
 
-			// Copy values to arrayj = object.begin();
-			j = object.begin();
-			for(size_t i = 0; i < s; ++i, ++j) {
-				array_[atoi(j->first.c_str())] = j->second;
+	value::string_t value::as_string() const {
+		switch(mType) {
+		case BOOL_T:
+			return string_t(mBool ? "true" : "false");
+		case CHAR_T:
+			return string_t(1, mChar);
+		case NUMBER_T:
+			{
+				char tmp[NUMBER_BUFFER_SIZE];
+				return string_t(tmp, format_number(mNumber, tmp));
+			}
+		case INT_T:
+			{
+				const std::string tmp = std::to_string(mInt);
+				return string_t(tmp.c_str(), tmp.size());
+			}
+		case UINT_T:
+			{
+				const std::string tmp = std::to_string(mUint);
+				return string_t(tmp.c_str(), tmp.size());
 			}
+		case STRING_T:
+			{
+				const string_ref tmp = get_string();
+				return string_t(tmp.data(), tmp.size());
+			}
+		default:
+			break;
+		}
 
-			const_cast<value*>(this)->set_array() = array_;
+		throw std::runtime_error("value : Value is not convertable to string");
+	}
+
+	value::array_t value::as_array() const {
+		switch(mType) {
+		case ARRAY_T:
 			return *mArray;
-		}
+		case PACKED_ARRAY_T:
+			{
+				const size_t s = mPackedArray->size();
+				array_t array_;
+				array_.reserve(s);
+				for(size_t i = 0; i < s; ++i) array_.push_back(sv_packed_element(*mPackedArray, i));
+				return array_;
+			}
+		case OBJECT_T:
+			{
+				// Objects are convertable when their keys are the indices 0 to size - 1
+				const size_t s = mObject->size();
+				array_t array_(s);
+				std::vector<bool> found(s, false);
+				for(const auto& i : *mObject) {
+					char* end;
+					const unsigned long index = std::strtoul(i.first.c_str(), &end, 10);
+					if(i.first.empty() || *end != '\0' || index >= s || found[index]) {
+						throw std::runtime_error("value : Value is not convertable to array");
+					}
+					found[index] = true;
+					array_[index] = i.second;
+				}
+				return array_;
+			}
 		default:
 			break;
 		}
@@ -403,23 +901,28 @@ namespace asmith { namespace serial {
 		throw std::runtime_error("value : Value is not convertable to array");
 	}
 
-	const value::object_t& value::get_object() const {
+	value::object_t value::as_object() const {
 		switch(mType) {
 		case ARRAY_T:
 			{
-				value tmp;
-				object_t& object = tmp.get_object();
+				object_t object;
 				const array_t& array_ = *mArray;
 				const size_t s = array_.size();
 				for(size_t i = 0; i < s; ++i) {
-					object.emplace(
-						std::to_string(i),
-						array_[i]
-					);
+					const std::string key = std::to_string(i);
+					object.emplace(key_t(key), array_[i]);
 				}
-
-				const_cast<value*>(this)->set_object() = object;
-				return *mObject;
+				return object;
+			}
+		case PACKED_ARRAY_T:
+			{
+				object_t object;
+				const size_t s = mPackedArray->size();
+				for(size_t i = 0; i < s; ++i) {
+					const std::string key = std::to_string(i);
+					object.emplace(key_t(key), sv_packed_element(*mPackedArray, i));
+				}
+				return object;
 			}
 		case OBJECT_T:
 			return *mObject;
@@ -430,19 +933,60 @@ namespace asmith { namespace serial {
 		throw std::runtime_error("value : Value is not convertable to object");
 	}
 
+	value::packed_array_t value::as_packed_array() const {
+		switch(mType) {
+		case ARRAY_T:
+			{
+				bool ints = true;
+				bool uints = true;
+				for(const value& i : *mArray) {
+					switch(i.mType) {
+					case NUMBER_T:
+						ints = uints = false;
+						break;
+					case INT_T:
+						uints = false;
+						break;
+					case UINT_T:
+						ints = false;
+						break;
+					default:
+						throw std::runtime_error("value : Value is not convertable to packed array");
+					}
+				}
+
+				const size_t s = mArray->size();
+				packed_array_t packed(ints ? packed_array_t::INT64_T : uints ? packed_array_t::UINT64_T : packed_array_t::DOUBLE_T);
+				packed.resize(s);
+				if(ints) {
+					int_t* const data = static_cast<int_t*>(packed.data());
+					for(size_t i = 0; i < s; ++i) data[i] = (*mArray)[i].mInt;
+				}else if(uints) {
+					uint_t* const data = static_cast<uint_t*>(packed.data());
+					for(size_t i = 0; i < s; ++i) data[i] = (*mArray)[i].mUint;
+				}else {
+					number_t* const data = static_cast<number_t*>(packed.data());
+					for(size_t i = 0; i < s; ++i) data[i] = (*mArray)[i].get_number();
+				}
+				return packed;
+			}
+		case PACKED_ARRAY_T:
+			return *mPackedArray;
+		default:
+			break;
+		}
+
+		throw std::runtime_error("value : Value is not convertable to packed array");
+	}
+
 	#define SV_JOIN2(a, b) a##b
 	#define SV_JOIN(a, b) SV_JOIN2(a , b)
 
 	#define SV_CONSTRUCTOR(VAL) \
 	value::value(VAL aValue) throw() :\
 		SV_VALUE(static_cast<SV_TYPE>(aValue)),\
-		mType(SV_ENUM)\
-	{}
-
-	#define SV_CONSTRUCTOR_NEW(VAL) \
-	value::value(VAL aValue) throw() :\
-		SV_VALUE(new SV_TYPE(aValue)),\
-		mType(SV_ENUM)\
+		mType(SV_ENUM),\
+		mFlags(0)\
 	{}
 
 	#define SV_SET \
@@ -456,9 +1000,15 @@ namespace asmith { namespace serial {
 
 	#define SV_SET_NEW \
 	value::SV_TYPE& value::SV_JOIN(set_,SV_NAME)() throw() {\
-		if(mType != SV_ENUM) {\
+		if(mType != SV_ENUM || (mFlags & (SHARED_FLAG | SHORT_STRING_FLAG))) {\
 			set_null();\
-			SV_VALUE = new SV_TYPE();\
+			value_arena* const arena = value_arena::get_current();\
+			if(arena) {\
+				SV_VALUE = new(arena->allocate(sizeof(SV_TYPE), alignof(SV_TYPE))) SV_TYPE();\
+				mFlags = ARENA_FLAG;\
+			}else {\
+				SV_VALUE = new SV_TYPE();\
+			}\
 			mType = SV_ENUM;\
 		}else{\
 			SV_VALUE->clear();\
@@ -478,7 +1028,10 @@ namespace asmith { namespace serial {
 	#define SV_GET_NEW \
 	value::SV_TYPE& value::SV_JOIN(get_,SV_NAME)() throw() {\
 		if(mType != SV_ENUM) {\
-			static_cast<const value*>(this)->SV_JOIN(get_,SV_NAME)();\
+			SV_TYPE tmp = SV_JOIN(as_,SV_NAME)();\
+			SV_JOIN(set_,SV_NAME)() = std::move(tmp);\
+		}else {\
+			detach();\
 		}\
 		return *SV_VALUE;\
 	}
@@ -493,9 +1046,32 @@ namespace asmith { namespace serial {
 	#define SV_VALUE
 
 	value::SV_TYPE value::SV_JOIN(set_, SV_NAME)() throw() {
+		// Arena backed payloads are reclaimed by value_arena::release
+		if(mFlags & ARENA_FLAG) mType = SV_ENUM;
+
+		if(mFlags & SHARED_FLAG) {
+			switch(mType) {
+			case STRING_T:
+				sv_shared<string_t>::release(mString);
+				break;
+			case ARRAY_T:
+				sv_shared<array_t>::release(mArray);
+				break;
+			case OBJECT_T:
+				sv_shared<object_t>::release(mObject);
+				break;
+			case PACKED_ARRAY_T:
+				sv_shared<packed_array_t>::release(mPackedArray);
+				break;
+			default:
+				break;
+			}
+			mType = SV_ENUM;
+		}
+
 		switch(mType) {
 		case STRING_T:
-			delete mString;
+			if(! (mFlags & SHORT_STRING_FLAG)) delete mString;
 			break;
 		case ARRAY_T:
 			delete mArray;
@@ -503,11 +1079,15 @@ namespace asmith { namespace serial {
 		case OBJECT_T:
 			delete mObject;
 			break;
+		case PACKED_ARRAY_T:
+			delete mPackedArray;
+			break;
 		default:
 			break;
 		}
-		mString = nullptr;
+		mArray = nullptr;
 		mType = SV_ENUM;
+		mFlags = 0;
 	}
 
 	#undef SV_NAME
@@ -545,16 +1125,40 @@ namespace asmith { namespace serial {
 	#define SV_ENUM NUMBER_T
 	#define SV_VALUE mNumber
 
-	SV_CONSTRUCTOR(uint8_t)
-	SV_CONSTRUCTOR(uint16_t)
-	SV_CONSTRUCTOR(uint32_t)
-	SV_CONSTRUCTOR(uint64_t)
+	SV_CONSTRUCTOR(float)
+	SV_CONSTRUCTOR(double)
+	SV_SET
+	SV_GET
+
+	#undef SV_NAME
+	#undef SV_TYPE
+	#undef SV_ENUM
+	#undef SV_VALUE
+	#define SV_NAME int
+	#define SV_TYPE int_t
+	#define SV_ENUM INT_T
+	#define SV_VALUE mInt
+
 	SV_CONSTRUCTOR(int8_t)
 	SV_CONSTRUCTOR(int16_t)
 	SV_CONSTRUCTOR(int32_t)
 	SV_CONSTRUCTOR(int64_t)
-	SV_CONSTRUCTOR(float)
-	SV_CONSTRUCTOR(double)
+	SV_SET
+	SV_GET
+
+	#undef SV_NAME
+	#undef SV_TYPE
+	#undef SV_ENUM
+	#undef SV_VALUE
+	#define SV_NAME uint
+	#define SV_TYPE uint_t
+	#define SV_ENUM UINT_T
+	#define SV_VALUE mUint
+
+	SV_CONSTRUCTOR(uint8_t)
+	SV_CONSTRUCTOR(uint16_t)
+	SV_CONSTRUCTOR(uint32_t)
+	SV_CONSTRUCTOR(uint64_t)
 	SV_SET
 	SV_GET
 
@@ -567,10 +1171,63 @@ namespace asmith { namespace serial {
 	#define SV_ENUM STRING_T
 	#define SV_VALUE mString
 
-	SV_CONSTRUCTOR_NEW(const char*)
-	SV_CONSTRUCTOR_NEW(const std::string&)
+	value::value(const char* aValue) throw() :
+		mType(NULL_T),
+		mFlags(0)
+	{
+		set_string(aValue, std::strlen(aValue));
+	}
+
+	value::value(const std::string& aValue) throw() :
+		mType(NULL_T),
+		mFlags(0)
+	{
+		set_string(aValue.data(), aValue.size());
+	}
+
+	value::value(const string_t& aValue) throw() :
+		mType(NULL_T),
+		mFlags(0)
+	{
+		set_string(aValue.data(), aValue.size());
+	}
+
 	SV_SET_NEW
-	SV_GET_NEW
+
+	void value::set_string(const char* aValue, const size_t aSize) throw() {
+		if(aSize <= SHORT_STRING_CAPACITY) {
+			// aValue may be part of this value, so it is copied before the current payload is released
+			char tmp[SHORT_STRING_CAPACITY];
+			if(aSize > 0) std::memcpy(tmp, aValue, aSize);
+			set_null();
+			std::memcpy(short_string(), tmp, aSize);
+			mType = SV_ENUM;
+			mFlags = static_cast<uint8_t>(SHORT_STRING_FLAG | (aSize << SHORT_STRING_SHIFT));
+		}else if(mType == SV_ENUM && ! (mFlags & (SHARED_FLAG | SHORT_STRING_FLAG))) {
+			// basic_string::assign allows the characters to be part of the string
+			SV_VALUE->assign(aValue, aSize);
+		}else {
+			value tmp;
+			tmp.set_string().assign(aValue, aSize);
+			set_null();
+			move_from(tmp);
+		}
+	}
+
+	value::SV_TYPE& value::get_string() throw() {
+		if(mType != SV_ENUM) {
+			SV_TYPE tmp = as_string();
+			set_string() = std::move(tmp);
+		}else if(mFlags & SHORT_STRING_FLAG) {
+			char tmp[SHORT_STRING_CAPACITY];
+			const size_t size = mFlags >> SHORT_STRING_SHIFT;
+			std::memcpy(tmp, short_string(), size);
+			set_string().assign(tmp, size);
+		}else {
+			detach();
+		}
+		return *SV_VALUE;
+	}
 
 	#undef SV_NAME
 	#undef SV_TYPE
@@ -596,12 +1253,23 @@ namespace asmith { namespace serial {
 	SV_SET_NEW
 	SV_GET_NEW
 
+	#undef SV_NAME
+	#undef SV_TYPE
+	#undef SV_ENUM
+	#undef SV_VALUE
+	#define SV_NAME packed_array
+	#define SV_TYPE packed_array_t
+	#define SV_ENUM PACKED_ARRAY_T
+	#define SV_VALUE mPackedArray
+
+	SV_SET_NEW
+	SV_GET_NEW
+
 	#undef SV_NAME
 	#undef SV_TYPE
 	#undef SV_ENUM
 	#undef SV_VALUE
 	#undef SV_CONSTRUCTOR
-	#undef SV_CONSTRUCTOR_NEW
 	#undef SV_SET
 	#undef SV_SET_NEW
 	#undef SV_GET
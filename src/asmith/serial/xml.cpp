@@ -13,6 +13,8 @@
 
 #include "asmith/serial/xml.hpp"
 #include <cctype>
+#include <cstring>
+#include "asmith/serial/number.hpp"
 #include "asmith/serial/string_tools.hpp"
 	
 namespace asmith { namespace serial {
@@ -194,16 +196,23 @@ namespace asmith { namespace serial {
 			aStream << aType.get_char() ;
 			break;
 		case value::NUMBER_T:
-			aStream << aType.get_number();
+			write_number(aStream, aType.get_number());
+			break;
+		case value::INT_T:
+			aStream << aType.get_int();
+			break;
+		case value::UINT_T:
+			aStream << aType.get_uint();
 			break;
 		case value::STRING_T:
 			{
-				std::string str = aType.get_string();
+				std::string str = aType.get_string().str();
 				xml_encode_string(str);
 				aStream << str;
 			}
 			break;
 		case value::ARRAY_T:
+		case value::PACKED_ARRAY_T:
 			throw std::runtime_error("xml_format : Cannot write array as internal value");
 			break;
 		case value::OBJECT_T:
@@ -235,20 +244,29 @@ namespace asmith { namespace serial {
 			break;
 		case value::NUMBER_T:
 			aStream << ">";
-			aStream << aType.get_number();
+			write_number(aStream, aType.get_number());
+			break;
+		case value::INT_T:
+			aStream << ">";
+			aStream << aType.get_int();
+			break;
+		case value::UINT_T:
+			aStream << ">";
+			aStream << aType.get_uint();
 			break;
 		case value::STRING_T:
 			aStream << ">";			
 			{
-				std::string str = aType.get_string();
+				std::string str = aType.get_string().str();
 				xml_encode_string(str);
 				aStream << str;
 			}
 			break;
 		case value::ARRAY_T:
+		case value::PACKED_ARRAY_T:
 			aStream << ">";
 			{
-				const value::array_t tmp = aType.get_array();
+				const value::array_t tmp = aType.as_array();
 				const size_t s = tmp.size();
 				for(size_t i = 0; i < s; ++i) {
 					xml_write_element(std::to_string(i).c_str(), tmp[i], aStream);
@@ -262,7 +280,7 @@ namespace asmith { namespace serial {
 
 				for(const auto& v : tmp) {
 					const value::type t = v.second.get_type();
-					if(t != value::ARRAY_T && t != value::OBJECT_T) {
+					if(t != value::ARRAY_T && t != value::PACKED_ARRAY_T && t != value::OBJECT_T) {
 						aStream << ' ' << v.first << '=' << '"';
 						xml_write_internal(v.second, aStream);
 						aStream << '"';
@@ -273,7 +291,7 @@ namespace asmith { namespace serial {
 
 				for (const auto& v : tmp) {
 					const value::type t = v.second.get_type();
-					if(t == value::ARRAY_T || t == value::OBJECT_T) {
+					if(t == value::ARRAY_T || t == value::PACKED_ARRAY_T || t == value::OBJECT_T) {
 						xml_write_element(v.first.c_str(), v.second, aStream);
 					}
 				}
@@ -338,7 +356,7 @@ namespace asmith { namespace serial {
 			
 			void add_body(const char* aStr) override {
 				if(mValueStack.back()->size() > 0) throw std::runtime_error("asmith::xml_format::read_serial : Cannot parse XML element with both attributes and a body");
-				mValueStack.back()->set_string() = aStr;
+				mValueStack.back()->set_string(aStr, std::strlen(aStr));
 			}
 		};
 
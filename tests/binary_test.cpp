@@ -0,0 +1,161 @@
+//	Copyright 2017 Adam Smith
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+// 
+//	http://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+
+
+#include <sstream>
+#include "asmith/serial/binary.hpp"
+#include "test.hpp"
+
+using namespace asmith::serial;
+
+static std::string write_binary(const value& aValue, const int aMode) {
+	std::ostringstream tmp;
+	binary_format().set_indexed((aMode & 1) != 0).set_key_dictionary((aMode & 2) != 0).set_columnar((aMode & 4) != 0).write_serial(aValue, tmp);
+	return tmp.str();
+}
+
+static value read_binary(const std::string& aData) {
+	std::istringstream tmp(aData);
+	return binary_format().read_serial(tmp);
+}
+
+//! \brief Read corrupt input, which may succeed or throw but must never crash
+static void read_corrupt(const std::string& aData, const bool aIndexed) {
+	try {
+		read_binary(aData);
+	}catch(std::exception&) {}
+
+	if(! aIndexed) return;
+	try {
+		const binary_document document(aData.data(), aData.size());
+		document.root().materialise();
+	}catch(std::exception&) {}
+}
+
+static void test_round_trip() {
+	const value document = test::sample_document();
+	for(int mode = 0; mode < 8; ++mode) {
+		const std::string data = write_binary(document, mode);
+		CHECK(read_binary(data) == document);
+
+		if(mode & 1) {
+			const binary_document tmp(data.data(), data.size());
+			const binary_node root = tmp.root();
+			CHECK(root.materialise() == document);
+			CHECK(root["uint"].get_uint() == 18446744073709551615ull);
+			CHECK(root["long"].get_string().str() == document["long"].get_string().str());
+			const binary_node records = root["records"];
+			CHECK(records.size() == 20);
+
+			const value selected = records.materialise(std::vector<std::string>{ "name", "missing" });
+			CHECK(selected.size() == 20);
+			CHECK(selected[size_t(7)].size() == 1);
+			CHECK(selected[size_t(7)]["name"] == value("record 7"));
+
+			if(mode & 4) {
+				CHECK(records.columns()["score"].get_type() == value::PACKED_ARRAY_T);
+				CHECK(test::throws([&]() { records[size_t(0)]; }));
+			}else {
+				CHECK(records[size_t(3)]["id"].get_uint() == 3);
+			}
+		}
+	}
+
+	// Version 3 readers still accept an empty top level container and scalars
+	for(int mode = 0; mode < 8; ++mode) {
+		CHECK(read_binary(write_binary(value(value::ARRAY_T), mode)) == value(value::ARRAY_T));
+		CHECK(read_binary(write_binary(value(value::OBJECT_T), mode)) == value(value::OBJECT_T));
+		CHECK(read_binary(write_binary(value(2.5), mode)) == value(2.5));
+	}
+}
+
+static void test_truncated() {
+	const value document = test::sample_document();
+	for(int mode = 0; mode < 8; ++mode) {
+		const std::string data = write_binary(document, mode);
+		for(size_t i = 0; i < data.size(); ++i) {
+			const std::string prefix = data.substr(0, i);
+			CHECK(test::throws([&]() { read_binary(prefix); }));
+			if(mode & 1) {
+				CHECK(test::throws([&]() {
+					const binary_document tmp(prefix.data(), prefix.size());
+					tmp.root().materialise();
+				}));
+			}
+		}
+	}
+}
+
+static void test_corrupt() {
+	// A root array whose offset table points back at itself
+	const char cycle[] = { 'A', 'S', 'B', 3, 1, 5, 1, 5, 0, 0, 0, 0, 0, 0, 0 };
+	const binary_document document(cycle, sizeof(cycle));
+	CHECK(test::throws([&]() { document.root().materialise(); }));
+
+	// A bool that is neither 0 nor 1
+	const char boolean[] = { 'A', 'S', 'B', 3, 1, 1, 2 };
+	CHECK(test::throws([&]() { read_binary(std::string(boolean, sizeof(boolean))); }));
+	CHECK(test::throws([&]() { binary_document(boolean, sizeof(boolean)).root().get_bool(); }));
+
+	CHECK(test::throws([&]() { read_binary("XYZ"); }));
+	CHECK(test::throws([&]() { read_binary(std::string("ASB\x09\x00\x00", 6)); }));
+
+	// Each level is an array whose two offsets point at the same child, decoding it would take 2^depth steps
+	std::string shared("ASB\x03\x01", 5);
+	for(int i = 0; i < 40; ++i) {
+		const uint64_t child = shared.size() + 2 + 2 * sizeof(uint64_t);
+		shared += static_cast<char>(value::ARRAY_T);
+		shared += static_cast<char>(2);
+		shared.append(reinterpret_cast<const char*>(&child), sizeof(child));
+		shared.append(reinterpret_cast<const char*>(&child), sizeof(child));
+	}
+	shared += static_cast<char>(value::NULL_T);
+	const binary_document dag(shared.data(), shared.size());
+	CHECK(test::throws([&]() { dag.root().materialise(); }));
+	CHECK(test::throws([&]() { dag.root().materialise(std::vector<std::string>{ "a" }); }));
+	CHECK(dag.root()[size_t(1)][size_t(0)].get_type() == value::ARRAY_T);
+
+	value deep;
+	value* tmp = &deep;
+	for(int i = 0; i < 1000; ++i) {
+		tmp->set_array();
+		tmp = &tmp->push_back(value());
+	}
+	for(int mode = 0; mode < 2; ++mode) {
+		const std::string data = write_binary(deep, mode);
+		CHECK(test::throws([&]() { read_binary(data); }));
+	}
+}
+
+static void test_fuzz() {
+	const value document = test::sample_document();
+	test::random random(1);
+	for(int mode = 0; mode < 8; ++mode) {
+		const std::string data = write_binary(document, mode);
+		for(int i = 0; i < 500; ++i) {
+			std::string tmp = data;
+			const uint64_t edits = 1 + random() % 4;
+			for(uint64_t j = 0; j < edits; ++j) tmp[random() % tmp.size()] = static_cast<char>(random());
+			if(random() % 4 == 0) tmp.resize(random() % tmp.size());
+			read_corrupt(tmp, (mode & 1) != 0);
+		}
+	}
+}
+
+int main() {
+	test_round_trip();
+	test_truncated();
+	test_corrupt();
+	test_fuzz();
+	return test::result("binary_test");
+}
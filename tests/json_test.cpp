@@ -0,0 +1,251 @@
+//	Copyright 2017 Adam Smith
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+// 
+//	http://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+
+
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include "asmith/serial/json.hpp"
+#include "test.hpp"
+
+using namespace asmith::serial;
+
+//! \brief A stream buffer that cannot seek, like a pipe
+class pipe_buffer : public std::streambuf {
+private:
+	std::string mData;
+	size_t mPosition;
+	char mCharacter;
+public:
+	explicit pipe_buffer(const std::string& aData) :
+		mData(aData),
+		mPosition(0),
+		mCharacter(0)
+	{}
+
+	int_type underflow() override {
+		if(mPosition >= mData.size()) return traits_type::eof();
+		mCharacter = mData[mPosition++];
+		setg(&mCharacter, &mCharacter, &mCharacter + 1);
+		return traits_type::to_int_type(mCharacter);
+	}
+};
+
+//! \brief The sample document without the types that JSON cannot represent
+static value json_document_value() {
+	value tmp = test::sample_document();
+	tmp.remove_member("char");
+	tmp.remove_member("packed");
+	return tmp;
+}
+
+static value parse(const std::string& aText) {
+	return json_format().read_serial(aText.data(), aText.size());
+}
+
+static std::string write_json(const value& aValue, const bool aFancy) {
+	std::ostringstream tmp;
+	json_format().set_fancy_writing(aFancy).write_serial(aValue, tmp);
+	return tmp.str();
+}
+
+static void test_parser() {
+	const value tmp = parse(" {\"a\" : [1, -2, 2.5, true, false, null, \"x\"], \"b\" : {}} ");
+	CHECK(tmp.get_type() == value::OBJECT_T);
+	CHECK(tmp["a"].size() == 7);
+	CHECK(tmp["a"][size_t(0)] == value(static_cast<uint64_t>(1)));
+	CHECK(tmp["a"][size_t(1)] == value(static_cast<int64_t>(-2)));
+	CHECK(tmp["a"][size_t(2)] == value(2.5));
+	CHECK(tmp["a"][size_t(3)] == value(true));
+	CHECK(tmp["a"][size_t(5)].get_type() == value::NULL_T);
+	CHECK(tmp["a"][size_t(6)] == value("x"));
+	CHECK(tmp["b"].get_type() == value::OBJECT_T && tmp["b"].size() == 0);
+
+	CHECK(parse("\"\\\"\\\\\\/\\b\\f\\n\\r\\t\\u00e9\\ud83d\\ude00\"") == value("\"\\/\b\f\n\r\t\xc3\xa9\xf0\x9f\x98\x80"));
+	CHECK(parse("18446744073709551615") == value(static_cast<uint64_t>(18446744073709551615ull)));
+	CHECK(parse("-9223372036854775808") == value(static_cast<int64_t>(-9223372036854775807ll - 1)));
+
+	const char* const invalid[] = {
+		"", "[", "{\"a\"}", "{\"a\":}", "{1:2}", "tru", "nul", "\"abc", "\"\\x\"", "[1]x", "1 2", "{} {}", "01x"
+	};
+	for(const char* i : invalid) CHECK(test::throws([&]() { parse(i); }));
+
+	// Nesting is limited so that hostile input cannot overflow the stack
+	CHECK(parse(std::string(512, '[') + std::string(512, ']')).get_type() == value::ARRAY_T);
+	const std::string deep(1000000, '[');
+	CHECK(test::throws([&]() { parse(deep); }));
+	CHECK(test::throws([&]() { parse(std::string(513, '[') + std::string(513, ']')); }));
+	CHECK(test::throws([&]() {
+		json_push_parser parser;
+		parser.feed(deep.data(), deep.size());
+	}));
+	std::string objects;
+	for(int i = 0; i < 100000; ++i) objects += "{\"a\":";
+	CHECK(test::throws([&]() { parse(objects); }));
+}
+
+static void test_streams() {
+	const value document = json_document_value();
+	const std::string text = write_json(document, false);
+
+	// Seekable streams are left at the end of the document
+	std::istringstream seekable(text + " [1]");
+	CHECK(json_format().read_serial(seekable) == document);
+	CHECK(json_format().read_serial(seekable).size() == 1);
+
+	// Each read only consumes its own document, whether it is shorter or longer than a block
+	std::string many;
+	for(int i = 0; i < 2000; ++i) {
+		const std::string padding(i % 5 == 0 ? 2000 : 1, ' ');
+		many += "[" + std::to_string(i) + "," + padding + "0] \"s\"\n" + std::to_string(i) + " ";
+	}
+	std::istringstream consecutive(many);
+	for(int i = 0; i < 2000; ++i) {
+		CHECK(json_format().read_serial(consecutive)[size_t(0)] == value(static_cast<uint64_t>(i)));
+		CHECK(json_format().read_serial(consecutive) == value("s"));
+		CHECK(json_format().read_serial(consecutive) == value(static_cast<uint64_t>(i)));
+	}
+
+	// Non-seekable streams stop at the end of each document
+	pipe_buffer buffer("{\"a\":[1,\"x]}\"]} [2] 3 \"s\" true\n4");
+	std::istream pipe(&buffer);
+	CHECK(json_format().read_serial(pipe)["a"][size_t(1)] == value("x]}"));
+	CHECK(json_format().read_serial(pipe)[size_t(0)] == value(static_cast<uint64_t>(2)));
+	CHECK(json_format().read_serial(pipe) == value(static_cast<uint64_t>(3)));
+	CHECK(json_format().read_serial(pipe) == value("s"));
+	CHECK(json_format().read_serial(pipe) == value(true));
+	CHECK(json_format().read_serial(pipe) == value(static_cast<uint64_t>(4)));
+}
+
+static void test_writer() {
+	const value document = json_document_value();
+	for(int fancy = 0; fancy < 2; ++fancy) {
+		const std::string text = write_json(document, fancy != 0);
+		CHECK(parse(text) == document);
+	}
+
+	CHECK(write_json(value("a\"b\\c\n\x01"), false) == "\"a\\\"b\\\\c\\n\\u0001\"");
+	CHECK(write_json(value(0.1), false) == "0.1");
+	CHECK(write_json(value(static_cast<int64_t>(-3)), false) == "-3");
+
+	// Finite doubles round trip exactly, JSON has no way to write the others
+	const double numbers[] = {
+		0.1, -0.0, 1e300, -1e-300, 4.9406564584124654e-324, 1.7976931348623157e308
+	};
+	for(const double i : numbers) {
+		const value tmp = parse(write_json(value(i), false));
+		CHECK(tmp.get_type() == value::NUMBER_T && tmp.get_number() == i && std::signbit(tmp.get_number()) == std::signbit(i));
+	}
+	const double non_finite[] = {
+		std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity()
+	};
+	for(const double i : non_finite) {
+		value tmp(value::ARRAY_T);
+		tmp.push_back(value(i));
+		CHECK(test::throws([&]() { write_json(tmp, false); }));
+		value packed;
+		packed.set_packed_array() = tmp.as_packed_array();
+		CHECK(test::throws([&]() { write_json(packed, true); }));
+	}
+}
+
+static void test_document() {
+	const std::string text = write_json(json_document_value(), false);
+	const json_document document(text.data(), text.size());
+	const json_node root = document.root();
+	CHECK(root.materialise() == json_document_value());
+	CHECK(root["records"].size() == 20);
+	CHECK(root["records"][size_t(4)]["name"].get_string() == "record 4");
+	CHECK(root["uint"].get_uint() == 18446744073709551615ull);
+
+	size_t members = 0;
+	for(json_node::iterator i = root.begin(); i != root.end(); ++i) ++members;
+	CHECK(members == root.size());
+
+	// Typed reads take one document from a stream and reject trailing data in a buffer
+	std::istringstream stream("[1,2] [3]");
+	CHECK(json_format().read<std::vector<int>>(stream) == std::vector<int>({1, 2}));
+	CHECK(json_format().read<std::vector<int>>(stream) == std::vector<int>({3}));
+	const std::string trailing = "[1,2] x";
+	CHECK(test::throws([&]() { json_format().read<std::vector<int>>(trailing.data(), trailing.size()); }));
+	CHECK(test::throws([&]() { json_document tmp(trailing.data(), trailing.size()); }));
+	CHECK(json_format().read<int>(" 7 ", 3) == 7);
+}
+
+static void test_push_parser() {
+	const value document = json_document_value();
+	const std::string text = write_json(document, true);
+
+	// Every token is split at least once when the document is fed a byte at a time
+	json_push_parser parser;
+	json_push_parser::status status = json_push_parser::NEED_MORE_INPUT;
+	for(size_t i = 0; i < text.size() && status == json_push_parser::NEED_MORE_INPUT; ++i) status = parser.feed(&text[i], 1);
+	CHECK(status == json_push_parser::COMPLETE);
+	CHECK(parser.take() == document);
+
+	parser.reset();
+	CHECK(parser.feed("12", 2) == json_push_parser::NEED_MORE_INPUT);
+	CHECK(parser.finish() == json_push_parser::COMPLETE);
+	CHECK(parser.take() == value(static_cast<uint64_t>(12)));
+}
+
+static void test_ndjson() {
+	std::vector<value> documents;
+	for(int i = 0; i < 100; ++i) {
+		value tmp(value::OBJECT_T);
+		tmp.add_member("index", value(static_cast<uint64_t>(i)));
+		tmp.add_member("text", value(std::string(i % 30, 'x')));
+		documents.push_back(tmp);
+	}
+
+	std::ostringstream output;
+	{
+		ndjson_writer writer(output);
+		for(const value& i : documents) writer.write(i);
+	}
+	const std::string text = output.str() + "\n\n";
+
+	std::istringstream input(text);
+	ndjson_reader reader(input);
+	value tmp;
+	size_t count = 0;
+	while(reader.read(tmp)) {
+		CHECK(count < documents.size() && tmp == documents[count]);
+		++count;
+	}
+	CHECK(count == documents.size());
+
+	count = 0;
+	ndjson_parallel_reader().set_threads(4).set_ordered(true).read(text.data(), text.size(), [&](value&& aValue) {
+		CHECK(count < documents.size() && aValue == documents[count]);
+		++count;
+	});
+	CHECK(count == documents.size());
+
+	const std::string invalid = "{\"a\":1}\n{\"a\"\n";
+	CHECK(test::throws([&]() {
+		ndjson_reader tmp2(invalid.data(), invalid.size());
+		value v;
+		while(tmp2.read(v));
+	}));
+}
+
+int main() {
+	test_parser();
+	test_streams();
+	test_writer();
+	test_document();
+	test_push_parser();
+	test_ndjson();
+	return test::result("json_test");
+}
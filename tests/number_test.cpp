@@ -0,0 +1,101 @@
+//	Copyright 2017 Adam Smith
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+// 
+//	http://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include "asmith/serial/json.hpp"
+#include "asmith/serial/number.hpp"
+#include "test.hpp"
+
+using namespace asmith::serial;
+
+static bool parse(const char* aText, parsed_number& aNumber) {
+	const char* const end = aText + std::strlen(aText);
+	return parse_number(aText, end, aNumber) == end;
+}
+
+//! \brief Format a double and parse it again, the result must have the same bits
+static bool round_trip(const double aValue) {
+	char buf[NUMBER_BUFFER_SIZE + 1];
+	buf[format_number(aValue, buf)] = '\0';
+	parsed_number tmp;
+	if(! parse(buf, tmp)) return false;
+	const double result = tmp.type == value::NUMBER_T ? tmp.number_value :
+		tmp.type == value::INT_T ? static_cast<double>(tmp.int_value) : static_cast<double>(tmp.uint_value);
+	return std::memcmp(&result, &aValue, sizeof(double)) == 0;
+}
+
+static void test_doubles() {
+	const double values[] = {
+		0.0, -0.0, 0.1, -0.1, 1.0 / 3.0, 1e300, -1e-300, 5e-324, 2.2250738585072014e-308,
+		std::numeric_limits<double>::max(), 9007199254740993.0, 123456789012345678.0, 1.5, 100.0
+	};
+	for(const double i : values) CHECK(round_trip(i));
+
+	test::random random(13);
+	for(int i = 0; i < 100000; ++i) {
+		const uint64_t bits = random();
+		double tmp;
+		std::memcpy(&tmp, &bits, sizeof(tmp));
+		if(std::isfinite(tmp)) CHECK(round_trip(tmp));
+	}
+}
+
+static void test_integers() {
+	char buf[NUMBER_BUFFER_SIZE + 1];
+	const value::int_t ints[] = { 0, 1, -1, 9, 10, -10, 1234567890123ll, std::numeric_limits<int64_t>::max(), std::numeric_limits<int64_t>::min() };
+	for(const value::int_t i : ints) {
+		buf[format_number(i, buf)] = '\0';
+		CHECK(std::to_string(i) == buf);
+		parsed_number tmp;
+		CHECK(parse(buf, tmp));
+		CHECK(tmp.type == value::INT_T && tmp.int_value == i);
+	}
+
+	const value::uint_t max = std::numeric_limits<uint64_t>::max();
+	buf[format_number(max, buf)] = '\0';
+	CHECK(std::string(buf) == "18446744073709551615");
+	parsed_number tmp;
+	CHECK(parse(buf, tmp) && tmp.type == value::UINT_T && tmp.uint_value == max);
+
+	// Integers that do not fit in 64 bits are read as doubles
+	CHECK(parse("18446744073709551616", tmp) && tmp.type == value::NUMBER_T && tmp.number_value == 18446744073709551616.0);
+	CHECK(parse("-9223372036854775809", tmp) && tmp.type == value::NUMBER_T);
+}
+
+static void test_negative_zero() {
+	parsed_number tmp;
+	CHECK(parse("-0", tmp) && tmp.type == value::NUMBER_T && std::signbit(tmp.number_value));
+	CHECK(parse("0", tmp) && tmp.type == value::INT_T && tmp.int_value == 0);
+
+	const value document = json_format().read_serial("-0", 2);
+	CHECK(document.get_type() == value::NUMBER_T && std::signbit(document.get_number()));
+}
+
+static void test_invalid() {
+	const char* const invalid[] = { "", "-", "+", ".5", "1.", "1e", "1e+", "--1", "0x10" };
+	for(const char* i : invalid) {
+		parsed_number tmp;
+		CHECK(! parse(i, tmp));
+	}
+}
+
+int main() {
+	test_doubles();
+	test_integers();
+	test_negative_zero();
+	test_invalid();
+	return test::result("number_test");
+}
@@ -0,0 +1,112 @@
+//	Copyright 2017 Adam Smith
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+// 
+//	http://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include "asmith/serial/value.hpp"
+
+#ifndef ASMITH_SERIAL_TEST_HPP
+#define ASMITH_SERIAL_TEST_HPP
+
+// Each test is a standalone program that returns a non-zero exit code when a check fails, for example
+// g++ -std=c++11 -Iinclude tests/value_test.cpp src/asmith/serial/*.cpp -lpthread && ./a.out
+
+namespace asmith { namespace serial { namespace test {
+
+	inline int& failures() throw() {
+		static int tmp = 0;
+		return tmp;
+	}
+
+	inline void fail(const char* aFile, const int aLine, const char* aCheck) {
+		std::cerr << aFile << ":" << aLine << " : CHECK(" << aCheck << ") failed" << std::endl;
+		++failures();
+	}
+
+	inline int result(const char* aName) {
+		std::cout << aName << (failures() == 0 ? " : passed" : " : FAILED") << std::endl;
+		return failures() == 0 ? 0 : 1;
+	}
+
+	//! \return True if the function threw std::runtime_error
+	template<class F>
+	bool throws(F aFunction) {
+		try {
+			aFunction();
+		}catch(std::runtime_error&) {
+			return true;
+		}
+		return false;
+	}
+
+	//! \brief Deterministic pseudo random numbers so that failures can be reproduced
+	class random {
+	private:
+		uint64_t mState;
+	public:
+		explicit random(const uint64_t aSeed) throw() :
+			mState(aSeed)
+		{}
+
+		uint64_t operator()() throw() {
+			// splitmix64
+			uint64_t tmp = (mState += 0x9e3779b97f4a7c15ull);
+			tmp = (tmp ^ (tmp >> 30)) * 0xbf58476d1ce4e5b9ull;
+			tmp = (tmp ^ (tmp >> 27)) * 0x94d049bb133111ebull;
+			return tmp ^ (tmp >> 31);
+		}
+	};
+
+	//! \brief A document that uses every value type, with arrays of uniform objects for columnar layouts
+	inline value sample_document() {
+		value tmp(value::OBJECT_T);
+		tmp.add_member("null", value());
+		tmp.add_member("bool", value(true));
+		tmp.add_member("char", value('c'));
+		tmp.add_member("number", value(-1.25));
+		tmp.add_member("int", value(static_cast<int64_t>(-1234567890123ll)));
+		tmp.add_member("uint", value(static_cast<uint64_t>(18446744073709551615ull)));
+		tmp.add_member("short", value("short"));
+		tmp.add_member("long", value("a string that is too long to be stored inside the value"));
+		tmp.add_member("empty", value(""));
+
+		value& records = tmp.add_member("records", value(value::ARRAY_T));
+		for(int i = 0; i < 20; ++i) {
+			value record(value::OBJECT_T);
+			record.add_member("id", value(static_cast<uint64_t>(i)));
+			record.add_member("delta", value(static_cast<int64_t>(i - 10)));
+			record.add_member("score", value(i * 0.5));
+			record.add_member("name", value(std::string("record ") + std::to_string(i)));
+			value& tags = record.add_member("tags", value(value::ARRAY_T));
+			tags.push_back(value(i % 2 == 0));
+			records.push_back(std::move(record));
+		}
+
+		value& ragged = tmp.add_member("ragged", value(value::ARRAY_T));
+		ragged.push_back(value(value::OBJECT_T)).add_member("a", value(1.0));
+		ragged.push_back(value(value::OBJECT_T)).add_member("b", value(2.0));
+
+		value& nested = tmp.add_member("nested", value(value::ARRAY_T));
+		nested.push_back(value(value::ARRAY_T)).push_back(value(value::OBJECT_T));
+
+		const float elements[] = { 0.f, 0.25f, -0.5f, 1e30f, 3.f };
+		tmp.add_member("packed", value()).set_packed_array().assign(packed_array::FLOAT_T, elements, 5);
+		return tmp;
+	}
+}}}
+
+#define CHECK(x) do { if(! (x)) asmith::serial::test::fail(__FILE__, __LINE__, #x); } while(0)
+
+#endif
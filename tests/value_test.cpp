@@ -0,0 +1,159 @@
+//	Copyright 2017 Adam Smith
+//	Licensed under the Apache License, Version 2.0 (the "License");
+//	you may not use this file except in compliance with the License.
+//	You may obtain a copy of the License at
+// 
+//	http://www.apache.org/licenses/LICENSE-2.0
+//
+//	Unless required by applicable law or agreed to in writing, software
+//	distributed under the License is distributed on an "AS IS" BASIS,
+//	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//	See the License for the specific language governing permissions and
+//	limitations under the License.
+
+
+#include <string>
+#include <utility>
+#include "asmith/serial/intern.hpp"
+#include "test.hpp"
+
+using namespace asmith::serial;
+
+static value::string_ref get_string(const value& aValue) {
+	return aValue.get_string();
+}
+
+static void test_move() {
+	value a = test::sample_document();
+	const value copy = a;
+	value b = std::move(a);
+	CHECK(a.get_type() == value::NULL_T);
+	CHECK(b == copy);
+
+	value c;
+	c = std::move(b);
+	CHECK(b.get_type() == value::NULL_T);
+	CHECK(c == copy);
+
+	// The source of an assignment may be part of the value that is assigned to
+	value tree = copy;
+	tree = tree["records"][size_t(3)];
+	CHECK(tree == copy["records"][size_t(3)]);
+	tree = copy;
+	tree = std::move(tree["records"]);
+	CHECK(tree == copy["records"]);
+	tree = tree;
+	CHECK(tree == copy["records"]);
+}
+
+static void test_strings() {
+	CHECK(sizeof(value) == 16);
+
+	const std::string lengths[] = { "", "a", std::string(value::SHORT_STRING_CAPACITY, 's'), std::string(value::SHORT_STRING_CAPACITY + 1, 'l'), std::string(1000, 'x') };
+	for(const std::string& i : lengths) {
+		value tmp(i);
+		CHECK(get_string(tmp).str() == i);
+		value copy = tmp;
+		CHECK(copy == tmp && copy.hash() == tmp.hash());
+		value moved = std::move(copy);
+		CHECK(get_string(moved).str() == i);
+	}
+
+	// Short strings move out of the value when they are modified through a reference
+	value tmp("abc");
+	tmp.get_string().append(40, 'd');
+	CHECK(get_string(tmp).str() == "abc" + std::string(40, 'd'));
+	tmp.get_string().resize(3);
+	CHECK(tmp == value("abc") && tmp.hash() == value("abc").hash());
+
+	// The characters may be part of the value that they are copied into
+	tmp.set_string(get_string(tmp).data() + 1, 2);
+	CHECK(tmp == value("bc"));
+	value long_string(std::string(40, 'x') + "y");
+	long_string.set_string(get_string(long_string).data() + 10, 31);
+	CHECK(get_string(long_string).str() == std::string(30, 'x') + "y");
+
+	CHECK(value(value::STRING_T) == value(""));
+	CHECK(value(12.5).get_string() == "12.5");
+}
+
+static void test_copy_on_write() {
+	value original = test::sample_document();
+	const value expected = original;
+	original.share();
+	CHECK(original.is_shared());
+	CHECK(original == expected && original.hash() == expected.hash());
+
+	value copy = original;
+	CHECK(copy.is_shared());
+
+	// Writing through a non-const member detaches only the value that is written
+	copy["records"][size_t(0)]["name"] = value("changed");
+	CHECK(! copy.is_shared());
+	CHECK(original.is_shared() && original == expected);
+	CHECK(copy != expected);
+
+	const value& constant = original;
+	CHECK(constant["records"][size_t(0)]["name"] == value("record 0"));
+	CHECK(original.is_shared());
+
+	// Interned documents share identical subtrees
+	value_intern_table table;
+	const value first = table.intern(expected);
+	const value second = table.intern(expected);
+	CHECK(first == second && first.hash() == second.hash());
+	CHECK(first.is_shared() && second.is_shared());
+}
+
+static void test_arena() {
+	value_arena arena;
+	{
+		const value_arena::scope scope(arena);
+		value document = test::sample_document();
+		value copy = document;
+		CHECK(copy == document);
+		document.set_null();
+		copy.set_null();
+	}
+	arena.release();
+
+	// Arena backed trees are never destroyed, so they must not hold references to shared payloads
+	value shared = test::sample_document();
+	shared.share();
+	{
+		const value_arena::scope scope(arena);
+		value copy = shared;
+		CHECK(! copy.is_shared() && copy == shared);
+	}
+	arena.release();
+
+	// Fill the name table so that new names are owned by their keys
+	for(size_t i = 0; i < 64 * 1024; ++i) value::key_t(std::to_string(i) + " filler");
+	value owned(value::OBJECT_T);
+	owned.add_member("owned heap name", value(1));
+	value survivor;
+	{
+		const value_arena::scope scope(arena);
+		value tree(value::OBJECT_T);
+		tree.add_member("owned arena name", value(2));
+		tree.add_member("other arena name", value(3));
+		tree.add_member("copied", owned);
+		const value copy = tree;
+		CHECK(copy == tree && copy["copied"]["owned heap name"] == value(1));
+		{
+			const value_arena::scope heap(nullptr);
+			survivor = tree;
+		}
+	}
+	arena.release();
+	CHECK(survivor["owned arena name"] == value(2) && survivor["copied"]["owned heap name"] == value(1));
+	CHECK(survivor.size() == 3 && survivor["other arena name"] == value(3));
+}
+
+int main() {
+	test_move();
+	test_strings();
+	test_copy_on_write();
+	test_arena();
+	return test::result("value_test");
+}